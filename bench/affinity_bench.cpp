@@ -0,0 +1,208 @@
+// bench/affinity_bench.cpp
+// 比較三種執行緒配置的吞吐量與延遲分位數：
+//   unpinned     不綁定
+//   pinned       只綁定執行緒 (依 CPU/NUMA 拓撲)，緩衝區維持預設配置
+//   pinned+numa  綁定執行緒，且輸入/輸出緩衝區配置在該節點上
+// 每個 worker 各自持有一個 Session，綁定模式下 worker 依序分配到各 NUMA 節點。
+// 所有模式的 OpenCV 都只用單一執行緒，差異只來自綁定與緩衝區配置；
+// 共跑 rounds 輪，奇數輪反轉模式順序，避免順序效應 (頻率爬升、快取、熱節流) 偏向某一模式。
+//
+// Usage: affinity_bench <path_to_onnx_model> <path_to_image> [iterations=200] [workers=NUMA 節點數] [rounds=3]
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../src/affinity/cpu_topology.h"
+#include "../src/inference/inference.h"
+#include "../src/postprocess/postprocess.h"
+#include "../src/preprocess/preprocess.h"
+#include "../src/utils/utils.h"
+
+namespace {
+
+const float kConfThreshold = 0.25f;
+const float kNmsThreshold = 0.45f;
+const int kWarmupIterations = 5;
+
+// 單一 worker 的 CPU 配置；cpus 為空代表不綁定
+struct WorkerPlan {
+    int node = -1;
+    std::vector<int> pipeline_cpus;
+    std::vector<int> inference_cpus;
+    int unpinned_threads = 0;  // 不綁定模式下的 intra-op 執行緒數
+    bool numa_buffers = false; // 輸入/輸出緩衝區配置在 node 上
+};
+
+struct BenchMode {
+    std::string label;
+    std::vector<WorkerPlan> plans;
+};
+
+struct BenchResult {
+    double wall_ms = 0.0;
+    std::vector<double> latencies_ms;
+};
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+BenchResult runMode(const std::string& model_path, const cv::Mat& image,
+                    const std::vector<std::string>& class_names,
+                    const std::vector<WorkerPlan>& plans, int iterations) {
+    std::vector<std::vector<double>> latencies(plans.size());
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+
+    for (size_t w = 0; w < plans.size(); ++w) {
+        workers.emplace_back([&, w]() {
+            const WorkerPlan& plan = plans[w];
+            AffinityScheduler::pinCurrentThread(plan.pipeline_cpus);
+
+            Ort::SessionOptions session_options;
+            session_options.SetGraphOptimizationLevel(ORT_ENABLE_BASIC);
+            if (plan.node >= 0) {
+                AffinityScheduler::configureSession(session_options, plan.inference_cpus);
+            } else {
+                session_options.SetIntraOpNumThreads(plan.unpinned_threads);
+            }
+            YOLOv12Inference yolo(model_path, class_names, session_options, kConfThreshold);
+
+            std::unique_ptr<NumaBuffer> input_buffer;
+            cv::Mat input_blob;
+            if (plan.numa_buffers) {
+                yolo.bindOutputToNode(plan.node);
+                int blob_dims[4] = {1, 3, static_cast<int>(yolo._input_height), static_cast<int>(yolo._input_width)};
+                input_buffer.reset(new NumaBuffer(3 * yolo._input_height * yolo._input_width * sizeof(float), plan.node));
+                input_blob = cv::Mat(4, blob_dims, CV_32F, input_buffer->data());
+            }
+            yolo.warmup(kWarmupIterations);
+
+            ready.fetch_add(1);
+            while (!go.load()) std::this_thread::yield();
+
+            latencies[w].reserve(iterations);
+            for (int i = 0; i < iterations; ++i) {
+                Timer timer;
+                LetterBoxInfo info = letterbox(image, yolo._input_width, yolo._input_height);
+                normalizeAndTranspose(info.processed_image, input_blob);
+                std::vector<Detection> detections = yolo.runInference(input_blob);
+                nonMaximumSuppression(detections, kNmsThreshold);
+                latencies[w].push_back(timer.elapsed_ms());
+            }
+        });
+    }
+
+    // 所有 worker 完成載入與預熱後同時開始，牆鐘時間只涵蓋量測區段
+    while (ready.load() < static_cast<int>(plans.size())) std::this_thread::yield();
+    Timer wall_timer;
+    go.store(true);
+    for (auto& t : workers) t.join();
+
+    BenchResult result;
+    result.wall_ms = wall_timer.elapsed_ms();
+    for (const auto& l : latencies) result.latencies_ms.insert(result.latencies_ms.end(), l.begin(), l.end());
+    return result;
+}
+
+void printResult(const std::string& label, const BenchResult& result) {
+    double throughput = result.latencies_ms.size() / (result.wall_ms / 1000.0);
+    std::cerr << label
+              << ": throughput=" << throughput << " fps"
+              << ", p50=" << percentile(result.latencies_ms, 0.50) << " ms"
+              << ", p99=" << percentile(result.latencies_ms, 0.99) << " ms"
+              << ", frames=" << result.latencies_ms.size() << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <path_to_onnx_model> <path_to_image> [iterations=200] [workers] [rounds=3]" << std::endl;
+        return -1;
+    }
+    std::string model_path = argv[1];
+    cv::Mat image = cv::imread(argv[2]);
+    if (image.empty()) {
+        std::cerr << "Error: Could not read image: " << argv[2] << std::endl;
+        return -1;
+    }
+    int iterations = (argc > 3) ? std::stoi(argv[3]) : 200;
+
+    CpuTopology topology = CpuTopology::discover();
+    topology.print();
+    if (topology.nodes.empty()) {
+        std::cerr << "Error: Could not discover CPU topology." << std::endl;
+        return -1;
+    }
+    int workers = (argc > 4) ? std::stoi(argv[4]) : static_cast<int>(topology.nodes.size());
+    workers = std::max(workers, 1);
+    int rounds = std::max((argc > 5) ? std::stoi(argv[5]) : 3, 1);
+
+    // bench 不需要類別名稱，以 80 個 COCO 類別的佔位名稱代替
+    std::vector<std::string> class_names(80, "object");
+
+    // 不綁定：每個 worker 平分所有 CPU 作為 intra-op 執行緒數
+    std::vector<WorkerPlan> unpinned(workers);
+    for (auto& plan : unpinned) {
+        plan.unpinned_threads = std::max<int>(1, static_cast<int>(topology.cpuCount()) / workers);
+    }
+
+    // 綁定：worker 輪流分配到各節點，每個 worker 在節點內取得互不重疊的 CPU
+    AffinityScheduler scheduler(topology);
+    std::vector<WorkerPlan> pinned(workers);
+    for (int w = 0; w < workers; ++w) {
+        const NumaNode& node = topology.nodes[w % topology.nodes.size()];
+        int workers_on_node = (workers - 1 - w % static_cast<int>(topology.nodes.size())) /
+                              static_cast<int>(topology.nodes.size()) + 1;
+        size_t share = std::max<size_t>(1, node.cpus.size() / workers_on_node);
+        WorkerPlan& plan = pinned[w];
+        plan.node = node.id;
+        plan.pipeline_cpus = scheduler.reserve("worker" + std::to_string(w) + ".pipeline", 1, node.id);
+        plan.inference_cpus = scheduler.reserve("worker" + std::to_string(w) + ".inference",
+                                                share > 1 ? share - 1 : 0, node.id);
+    }
+    std::cerr << "綁定模式的 CPU 配置:" << std::endl;
+    scheduler.print();
+
+    std::vector<WorkerPlan> pinned_numa = pinned;
+    for (auto& plan : pinned_numa) plan.numa_buffers = true;
+
+    std::vector<BenchMode> modes = {
+        {"unpinned   ", unpinned},
+        {"pinned     ", pinned},
+        {"pinned+numa", pinned_numa},
+    };
+    std::vector<BenchResult> totals(modes.size());
+
+    // 每個 worker 的前處理只使用自己的執行緒；不綁定模式也一樣，比較才只反映綁定本身
+    AffinityScheduler::limitOpenCvThreads(1);
+
+    NullBuffer null_buffer;
+    std::streambuf* original_cout = std::cout.rdbuf(&null_buffer);
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < modes.size(); ++i) {
+            size_t m = (round % 2 == 0) ? i : modes.size() - 1 - i;
+            BenchResult result = runMode(model_path, image, class_names, modes[m].plans, iterations);
+            totals[m].wall_ms += result.wall_ms;
+            totals[m].latencies_ms.insert(totals[m].latencies_ms.end(),
+                                          result.latencies_ms.begin(), result.latencies_ms.end());
+        }
+    }
+    std::cout.rdbuf(original_cout);
+
+    std::cerr << rounds << " 輪合計:" << std::endl;
+    for (size_t m = 0; m < modes.size(); ++m) {
+        printResult(modes[m].label, totals[m]);
+    }
+    return 0;
+}
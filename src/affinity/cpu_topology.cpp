@@ -0,0 +1,307 @@
+// src/affinity/cpu_topology.cpp
+#include "cpu_topology.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <set>
+#include <sstream>
+#include <opencv2/opencv.hpp>
+#include <onnxruntime_session_options_config_keys.h>
+
+namespace {
+
+const char* kNodeRoot = "/sys/devices/system/node";
+const char* kCpuRoot = "/sys/devices/system/cpu";
+const int kMpolBind = 2; // <linux/mempolicy.h> MPOL_BIND；直接使用系統呼叫以免依賴 libnuma
+
+std::string readFirstLine(const std::string& path) {
+    std::ifstream ifs(path);
+    std::string line;
+    std::getline(ifs, line);
+    return line;
+}
+
+// 以 "nodeN" / "cpuN" 這類目錄名稱列出 sysfs 子目錄的編號
+std::vector<int> listNumberedEntries(const std::string& root, const std::string& prefix) {
+    std::vector<int> ids;
+    DIR* dir = opendir(root.c_str());
+    if (!dir) {
+        return ids;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+            std::all_of(name.begin() + prefix.size(), name.end(), ::isdigit)) {
+            ids.push_back(std::stoi(name.substr(prefix.size())));
+        }
+    }
+    closedir(dir);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+// 本程序允許使用的 CPU (受 taskset/cgroup cpuset 限制)
+std::set<int> allowedCpus() {
+    std::set<int> allowed;
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &mask)) allowed.insert(cpu);
+        }
+    }
+    return allowed;
+}
+
+// 邏輯 CPU 在其實體核心內的序位 (0 為第一個超執行緒)
+int smtRank(int cpu) {
+    std::vector<int> siblings = parseCpuList(readFirstLine(
+        std::string(kCpuRoot) + "/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list"));
+    auto it = std::find(siblings.begin(), siblings.end(), cpu);
+    return it == siblings.end() ? 0 : static_cast<int>(it - siblings.begin());
+}
+
+// 邏輯 CPU 所屬實體核心的代表編號 (該核心第一個超執行緒)；讀不到時視為獨立核心
+int physicalCoreOf(int cpu) {
+    std::vector<int> siblings = parseCpuList(readFirstLine(
+        std::string(kCpuRoot) + "/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list"));
+    return siblings.empty() ? cpu : siblings.front();
+}
+
+// 先排各實體核心的第一個執行緒，再排其超執行緒，讓小的 CPU 集合不會落在同一個核心上
+void orderBySmtRank(std::vector<int>& cpus) {
+    std::vector<std::pair<int, int>> keyed;
+    for (int cpu : cpus) keyed.emplace_back(smtRank(cpu), cpu);
+    std::sort(keyed.begin(), keyed.end());
+    for (size_t i = 0; i < keyed.size(); ++i) cpus[i] = keyed[i].second;
+}
+
+} // namespace
+
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) continue;
+        size_t dash = range.find('-');
+        try {
+            if (dash == std::string::npos) {
+                cpus.push_back(std::stoi(range));
+            } else {
+                int first = std::stoi(range.substr(0, dash));
+                int last = std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            // 格式不符的片段直接忽略
+        }
+    }
+    return cpus;
+}
+
+std::pair<std::vector<int>, std::vector<int>> splitByPhysicalCore(const std::vector<int>& cpus) {
+    // 依實體核心第一次出現的順序編號
+    std::vector<int> cores;
+    std::vector<int> core_index;
+    for (int cpu : cpus) {
+        int core = physicalCoreOf(cpu);
+        auto it = std::find(cores.begin(), cores.end(), core);
+        if (it == cores.end()) {
+            core_index.push_back(static_cast<int>(cores.size()));
+            cores.push_back(core);
+        } else {
+            core_index.push_back(static_cast<int>(it - cores.begin()));
+        }
+    }
+    // 前半的核心歸第一組，其餘歸第二組
+    int first_half = static_cast<int>((cores.size() + 1) / 2);
+    std::pair<std::vector<int>, std::vector<int>> halves;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        (core_index[i] < first_half ? halves.first : halves.second).push_back(cpus[i]);
+    }
+    return halves;
+}
+
+// ---------------------------------------------------------------------------
+// CpuTopology
+// ---------------------------------------------------------------------------
+
+CpuTopology CpuTopology::discover() {
+    CpuTopology topology;
+    std::set<int> allowed = allowedCpus();
+
+    // 1. 優先使用 NUMA 節點資訊
+    for (int node_id : listNumberedEntries(kNodeRoot, "node")) {
+        NumaNode node;
+        node.id = node_id;
+        for (int cpu : parseCpuList(readFirstLine(std::string(kNodeRoot) + "/node" + std::to_string(node_id) + "/cpulist"))) {
+            if (allowed.count(cpu)) node.cpus.push_back(cpu);
+        }
+        if (!node.cpus.empty()) topology.nodes.push_back(node);
+    }
+
+    // 2. 核心沒有 NUMA 資訊時，以實體插槽分組
+    if (topology.nodes.empty()) {
+        std::map<int, NumaNode> packages;
+        for (int cpu : allowed) {
+            std::string package = readFirstLine(std::string(kCpuRoot) + "/cpu" + std::to_string(cpu) +
+                                                "/topology/physical_package_id");
+            int package_id = package.empty() ? 0 : std::stoi(package);
+            packages[package_id].id = package_id;
+            packages[package_id].cpus.push_back(cpu);
+        }
+        for (auto& entry : packages) topology.nodes.push_back(entry.second);
+    }
+
+    for (auto& node : topology.nodes) {
+        orderBySmtRank(node.cpus);
+    }
+    return topology;
+}
+
+size_t CpuTopology::cpuCount() const {
+    size_t count = 0;
+    for (const auto& node : nodes) count += node.cpus.size();
+    return count;
+}
+
+void CpuTopology::print() const {
+    std::cout << "CPU 拓撲: " << nodes.size() << " 個節點, " << cpuCount() << " 個可用 CPU" << std::endl;
+    for (const auto& node : nodes) {
+        std::cout << "  node" << node.id << ":";
+        for (int cpu : node.cpus) std::cout << " " << cpu;
+        std::cout << std::endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// AffinityScheduler
+// ---------------------------------------------------------------------------
+
+AffinityScheduler::AffinityScheduler(const CpuTopology& topology)
+    : _topology(topology)
+{
+    for (const auto& node : _topology.nodes) {
+        _next_free[node.id] = 0;
+    }
+}
+
+std::vector<int> AffinityScheduler::reserve(const std::string& stage, size_t count, int node) {
+    const NumaNode* target = nullptr;
+    size_t best_remaining = 0;
+    for (const auto& n : _topology.nodes) {
+        size_t remaining = n.cpus.size() - _next_free[n.id];
+        if (n.id == node || (node < 0 && remaining > best_remaining)) {
+            target = &n;
+            best_remaining = remaining;
+            if (n.id == node) break;
+        }
+    }
+    std::vector<int> cpus;
+    if (!target) {
+        return cpus;
+    }
+    size_t& next = _next_free[target->id];
+    while (cpus.size() < count && next < target->cpus.size()) {
+        cpus.push_back(target->cpus[next++]);
+    }
+    _plan.emplace_back(stage, cpus);
+    return cpus;
+}
+
+std::vector<int> AffinityScheduler::reserveRemaining(const std::string& stage, int node) {
+    for (const auto& n : _topology.nodes) {
+        if (n.id == node) {
+            return reserve(stage, n.cpus.size() - _next_free[n.id], node);
+        }
+    }
+    return {};
+}
+
+int AffinityScheduler::nodeOf(int cpu) const {
+    for (const auto& n : _topology.nodes) {
+        if (std::find(n.cpus.begin(), n.cpus.end(), cpu) != n.cpus.end()) return n.id;
+    }
+    return 0;
+}
+
+void AffinityScheduler::print() const {
+    for (const auto& entry : _plan) {
+        std::cout << "  " << entry.first << ":";
+        if (entry.second.empty()) std::cout << " (未綁定)";
+        for (int cpu : entry.second) std::cout << " " << cpu;
+        std::cout << std::endl;
+    }
+}
+
+bool AffinityScheduler::pinCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return false;
+    }
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : cpus) CPU_SET(cpu, &mask);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+    if (rc != 0) {
+        std::cerr << "警告: 無法設定執行緒 CPU 親和性: " << std::strerror(rc) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void AffinityScheduler::configureSession(Ort::SessionOptions& session_options, const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        session_options.SetIntraOpNumThreads(1); // 沒有額外的 CPU：只在呼叫者執行緒上計算
+        return;
+    }
+    // intra_op_num_threads = n 時需指定 n - 1 組親和性 (第 0 個執行緒為呼叫者)，
+    // 每組以 ';' 分隔，CPU 編號從 1 開始
+    std::string affinities;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        if (i > 0) affinities += ";";
+        affinities += std::to_string(cpus[i] + 1);
+    }
+    session_options.SetIntraOpNumThreads(static_cast<int>(cpus.size()) + 1);
+    session_options.AddConfigEntry(kOrtSessionOptionsConfigIntraOpThreadAffinities, affinities.c_str());
+}
+
+void AffinityScheduler::limitOpenCvThreads(int threads) {
+    cv::setNumThreads(std::max(threads, 0)); // 0 代表 OpenCV 不使用平行化
+}
+
+// ---------------------------------------------------------------------------
+// NumaBuffer
+// ---------------------------------------------------------------------------
+
+NumaBuffer::NumaBuffer(size_t bytes, int node)
+    : _data(nullptr)
+    , _bytes(bytes)
+    , _bound(false)
+{
+    _data = mmap(nullptr, _bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (_data == MAP_FAILED) {
+        _data = nullptr;
+        throw std::bad_alloc();
+    }
+    if (node >= 0 && node < static_cast<int>(sizeof(unsigned long) * 8)) {
+        unsigned long node_mask = 1UL << node;
+        _bound = syscall(SYS_mbind, _data, _bytes, kMpolBind, &node_mask, sizeof(node_mask) * 8 + 1, 0) == 0;
+    }
+    // 立即觸碰所有頁面：已 mbind 時頁面配置在指定節點，否則依 first-touch 配置在呼叫者所在節點
+    std::memset(_data, 0, _bytes);
+}
+
+NumaBuffer::~NumaBuffer() {
+    if (_data) {
+        munmap(_data, _bytes);
+    }
+}
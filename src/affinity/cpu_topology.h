@@ -0,0 +1,90 @@
+// src/affinity/cpu_topology.h
+#ifndef YOLO_CPU_TOPOLOGY_H
+#define YOLO_CPU_TOPOLOGY_H
+
+#include <onnxruntime_cxx_api.h>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 一個 NUMA 節點 (或在沒有 NUMA 資訊時的一個 CPU 插槽)
+struct NumaNode {
+    int id = 0;
+    std::vector<int> cpus; // 本程序可用的邏輯 CPU；每個實體核心的第一個執行緒排在前面
+};
+
+// 從 sysfs 讀取的 CPU/NUMA 拓撲
+struct CpuTopology {
+    std::vector<NumaNode> nodes;
+
+    // 讀取 /sys/devices/system/node 與 /sys/devices/system/cpu；
+    // 只保留 sched_getaffinity 允許的 CPU (容器 cpuset 限制)
+    static CpuTopology discover();
+
+    size_t cpuCount() const;
+    void print() const;
+};
+
+// 解析 sysfs 的 CPU 清單格式，例如 "0-3,8-11"
+std::vector<int> parseCpuList(const std::string& list);
+
+// 以實體核心為單位把 cpus 分成兩組 (同一核心的超執行緒必定在同一組)，兩組核心數相差至多一個，
+// 各組保留 cpus 中的原始順序；只有一個實體核心時第二組為空
+std::pair<std::vector<int>, std::vector<int>> splitByPhysicalCore(const std::vector<int>& cpus);
+
+// 將拓撲切分成各階段互不重疊的 CPU 集合，並套用到執行緒、ONNX Runtime 與 OpenCV
+class AffinityScheduler {
+public:
+    explicit AffinityScheduler(const CpuTopology& topology);
+
+    // 從 node (-1 表示剩餘 CPU 最多的節點) 保留 count 個 CPU 給 stage；
+    // 節點剩餘不足時回傳實際保留到的 CPU，可能為空
+    std::vector<int> reserve(const std::string& stage, size_t count, int node = -1);
+
+    // 保留 node 上剩下的所有 CPU
+    std::vector<int> reserveRemaining(const std::string& stage, int node);
+
+    // 回傳 cpu 所屬的 NUMA 節點 (找不到時為 0)
+    int nodeOf(int cpu) const;
+
+    // 印出各階段的 CPU 配置
+    void print() const;
+
+    // 把呼叫者執行緒綁定到 cpus；cpus 為空時不做任何事
+    static bool pinCurrentThread(const std::vector<int>& cpus);
+
+    // 設定 Session 的 intra-op 執行緒數與親和性。ORT 的第 0 個 intra-op 執行緒是呼叫 Run() 的執行緒，
+    // 其餘 cpus.size() 個工作執行緒各自綁定到 cpus 中的一個 CPU；cpus 為空時只使用呼叫者執行緒
+    static void configureSession(Ort::SessionOptions& session_options, const std::vector<int>& cpus);
+
+    // 限制 OpenCV 內部執行緒數 (cv::resize/cvtColor 的平行化)，避免與 ORT 搶核心
+    static void limitOpenCvThreads(int threads);
+
+private:
+    CpuTopology _topology;
+    std::map<int, size_t> _next_free;                 // 每個節點下一個可保留的 CPU 索引
+    std::vector<std::pair<std::string, std::vector<int>>> _plan; // 已保留的階段與 CPU
+};
+
+// 綁定在指定 NUMA 節點上的記憶體區塊；以 mmap 配置並以 mbind 綁定節點，
+// mbind 不可用時退回由呼叫者執行緒 first-touch
+class NumaBuffer {
+public:
+    NumaBuffer(size_t bytes, int node);
+    ~NumaBuffer();
+    NumaBuffer(const NumaBuffer&) = delete;
+    NumaBuffer& operator=(const NumaBuffer&) = delete;
+
+    void* data() const { return _data; }
+    size_t size() const { return _bytes; }
+    bool boundToNode() const { return _bound; }
+
+private:
+    void* _data;
+    size_t _bytes;
+    bool _bound;
+};
+
+#endif // YOLO_CPU_TOPOLOGY_H
@@ -6,12 +6,60 @@
 #include <array>     // 用於 std::array
 #include <cmath>     // 用於 expf 函數
 #include <algorithm> // 用於 std::sort
+#include <sstream>   // 用於解析類別過濾設定
+#include "../metrics/metrics.h"
+
+// 解析類別過濾設定
+ClassFilter ClassFilter::parse(const std::string& spec, const std::vector<std::string>& class_names) {
+    ClassFilter filter;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        std::string name = item;
+        float threshold = -1.0f;
+        size_t colon = item.rfind(':');
+        if (colon != std::string::npos) {
+            name = item.substr(0, colon);
+            try {
+                threshold = std::stof(item.substr(colon + 1));
+            } catch (const std::exception&) {
+                std::cerr << "警告: 無法解析類別閾值，略過: " << item << std::endl;
+                continue;
+            }
+        }
+
+        // 先以名稱比對，再嘗試當作類別 ID
+        int class_id = -1;
+        auto it = std::find(class_names.begin(), class_names.end(), name);
+        if (it != class_names.end()) {
+            class_id = static_cast<int>(it - class_names.begin());
+        } else if (!name.empty() && name.find_first_not_of("0123456789") == std::string::npos) {
+            try {
+                class_id = std::stoi(name);
+            } catch (const std::out_of_range&) {
+                class_id = -1; // 超出 int 範圍的 ID 視為未知類別
+            }
+        }
+        if (class_id < 0 || class_id >= static_cast<int>(class_names.size())) {
+            std::cerr << "警告: 未知的類別，略過: " << name << std::endl;
+            continue;
+        }
+
+        filter.enabled_classes.push_back(class_id);
+        if (threshold >= 0.0f) {
+            filter.class_thresholds[class_id] = threshold;
+        }
+    }
+    return filter;
+}
 
 // YOLOv12Inference 類的建構函數
 YOLOv12Inference::YOLOv12Inference(const std::string& model_path,
                                  const std::vector<std::string>& class_names,
                                  const Ort::SessionOptions& session_options,
-                                 float conf_threshold)
+                                 float conf_threshold,
+                                 const ClassFilter& class_filter)
     : env(ORT_LOGGING_LEVEL_WARNING, "YOLOv12Inference") // 初始化 ONNX Runtime 環境，設置日誌級別和實例名
     , session(env, model_path.c_str(), session_options) // 初始化 ONNX Session，載入模型
     , _allocator(Ort::AllocatorWithDefaultOptions())    // 初始化 ONNX Runtime 預設分配器
@@ -22,6 +70,27 @@ YOLOv12Inference::YOLOv12Inference(const std::string& model_path,
 {
     // 呼叫輔助函數來獲取模型的輸入/輸出節點名稱和維度等信息
     get_model_info();
+
+    // 展開類別過濾設定：解碼器只掃描啟用類別的分數列
+    if (class_filter.enabled_classes.empty()) {
+        for (size_t j = 0; j < _class_names.size(); ++j) {
+            _enabled_classes.push_back(static_cast<int>(j));
+        }
+    } else {
+        _enabled_classes = class_filter.enabled_classes;
+        std::sort(_enabled_classes.begin(), _enabled_classes.end());
+        _enabled_classes.erase(std::unique(_enabled_classes.begin(), _enabled_classes.end()), _enabled_classes.end());
+    }
+    for (int class_id : _enabled_classes) {
+        if (class_id < 0 || class_id >= static_cast<int>(_class_names.size())) {
+            throw std::runtime_error("類別過濾設定包含無效的類別 ID: " + std::to_string(class_id));
+        }
+        auto it = class_filter.class_thresholds.find(class_id);
+        _enabled_thresholds.push_back(it != class_filter.class_thresholds.end() ? it->second : _conf_threshold);
+    }
+    if (_enabled_classes.size() < _class_names.size()) {
+        std::cout << "類別過濾: 只解碼 " << _enabled_classes.size() << " / " << _class_names.size() << " 個類別" << std::endl;
+    }
     std::cout << "YOLOv12Inference 已用模型初始化: " << model_path << std::endl;
 }
 
@@ -46,6 +115,7 @@ void YOLOv12Inference::get_model_info() {
     Ort::TypeInfo input_type_info = session.GetInputTypeInfo(0);
     auto tensor_info = input_type_info.GetTensorTypeAndShapeInfo();
     std::vector<int64_t> input_dims = tensor_info.GetShape();
+    _input_type = tensor_info.GetElementType();
 
     // 假設輸入張量是 NCHW (Batch, Channels, Height, Width) 格式
     // 檢查維度是否符合 4D 張量的預期，並且 Batch size 應為 1
@@ -72,6 +142,12 @@ void YOLOv12Inference::get_model_info() {
     auto output_name_allocated = session.GetOutputNameAllocated(0, _allocator);
     output_node_names.push_back(output_name_allocated.get());
 
+    // 儲存輸出張量形狀，熱切換模型時用來檢查新舊模型是否相容
+    Ort::TypeInfo output_type_info = session.GetOutputTypeInfo(0);
+    auto output_tensor_info = output_type_info.GetTensorTypeAndShapeInfo();
+    _output_shape = output_tensor_info.GetShape();
+    _output_type = output_tensor_info.GetElementType();
+
     // 檢查是否成功獲取了輸入和輸出節點名稱
     if (input_node_names.empty() || output_node_names.empty()) {
         throw std::runtime_error("未能獲取模型輸入/輸出名稱。模型可能格式不正確或為空。");
@@ -82,6 +158,29 @@ void YOLOv12Inference::get_model_info() {
     std::cout << "模型期望輸入尺寸 (H, W): " << _input_height << ", " << _input_width << std::endl;
 }
 
+// 以全零輸入執行推論以完成預熱
+void YOLOv12Inference::warmup(int iterations) {
+    // 建立與模型輸入尺寸一致的 NCHW float32 blob
+    int blob_dims[4] = {1, 3, static_cast<int>(_input_height), static_cast<int>(_input_width)};
+    cv::Mat dummy_blob(4, blob_dims, CV_32F, cv::Scalar(0));
+    for (int i = 0; i < iterations; ++i) {
+        infer(dummy_blob, false, true); // 不計入線上指標：冷啟動與全零輸入會扭曲延遲分佈
+    }
+}
+
+// 將輸出張量綁定到指定 NUMA 節點的緩衝區
+bool YOLOv12Inference::bindOutputToNode(int node) {
+    size_t output_size = 1;
+    for (int64_t dim : _output_shape) {
+        if (dim <= 0) {
+            return false; // 動態維度無法預先配置
+        }
+        output_size *= static_cast<size_t>(dim);
+    }
+    _output_buffer.reset(new NumaBuffer(output_size * sizeof(float), node));
+    return true;
+}
+
 // Sigmoid 函式實現
 // float YOLOv12Inference::sigmoid(float x) const {
 //     return 1.0f / (1.0f + expf(-x));
@@ -89,6 +188,10 @@ void YOLOv12Inference::get_model_info() {
 
 // 在預處理後的圖像上運行推論
 std::vector<Detection> YOLOv12Inference::runInference(const cv::Mat& processed_image) {
+    return infer(processed_image, true, false);
+}
+
+std::vector<Detection> YOLOv12Inference::infer(const cv::Mat& processed_image, bool record_metrics, bool throw_on_error) {
     // 1. 準備輸入張量
     // processed_image 應該已經是 NCHW (1, C, H, W) 格式的 float32 blob
     // 我們使用從模型資訊中獲取的 input_height 和 input_width 來確保形狀一致性
@@ -129,6 +232,7 @@ std::vector<Detection> YOLOv12Inference::runInference(const cv::Mat& processed_i
     );
 
     // 2. 執行推論
+    PipelineMetrics& metrics = pipelineMetrics();
     std::vector<Ort::Value> output_tensors;
     try {
         // 將 std::string 的向量轉換為 const char* 的陣列，以符合 Ort::Session::Run 的簽名
@@ -142,16 +246,37 @@ std::vector<Detection> YOLOv12Inference::runInference(const cv::Mat& processed_i
             output_node_names_c_str.push_back(name.c_str());
         }
 
-        output_tensors = session.Run(Ort::RunOptions{nullptr},
-                                     input_node_names_c_str.data(), // 輸入節點名稱陣列
-                                     &input_tensor,                 // 輸入張量
-                                     1,                             // 輸入張量數量
-                                     output_node_names_c_str.data(),// 輸出節點名稱陣列
-                                     output_node_names_c_str.size()); // 輸出節點數量
+        ScopedLatency run_latency(record_metrics ? &metrics.inference_seconds : nullptr);
+        if (_output_buffer) {
+            // 輸出直接寫入預先配置 (NUMA 本地) 的緩衝區
+            Ort::Value output_tensor = Ort::Value::CreateTensor<float>(
+                memory_info,
+                static_cast<float*>(_output_buffer->data()),
+                _output_buffer->size() / sizeof(float),
+                _output_shape.data(),
+                _output_shape.size());
+            session.Run(Ort::RunOptions{nullptr},
+                        input_node_names_c_str.data(), &input_tensor, 1,
+                        output_node_names_c_str.data(), &output_tensor, 1);
+            output_tensors.push_back(std::move(output_tensor));
+        } else {
+            output_tensors = session.Run(Ort::RunOptions{nullptr},
+                                         input_node_names_c_str.data(), // 輸入節點名稱陣列
+                                         &input_tensor,                 // 輸入張量
+                                         1,                             // 輸入張量數量
+                                         output_node_names_c_str.data(),// 輸出節點名稱陣列
+                                         output_node_names_c_str.size()); // 輸出節點數量
+        }
     } catch (const Ort::Exception& e) {
+        if (throw_on_error) {
+            throw;
+        }
         std::cerr << "ONNX Runtime 推論失敗: " << e.what() << std::endl;
+        if (record_metrics) metrics.inference_failures.inc();
         return {}; // 返回空檢測結果
     }
+    if (record_metrics) metrics.frames.inc();
+    ScopedLatency decode_latency(record_metrics ? &metrics.decode_seconds : nullptr); // 量測到函數結束 (輸出解碼)
 
     // 3. 解析輸出張量 (YOLOv12 的輸出結構需要根據實際模型而定)
     // 假設 YOLOv12 的輸出是一個 [1, num_detections, 5 + num_classes] 的張量
@@ -160,6 +285,9 @@ std::vector<Detection> YOLOv12Inference::runInference(const cv::Mat& processed_i
 
     std::vector<Detection> detections;
     if (output_tensors.empty()) {
+        if (throw_on_error) {
+            throw std::runtime_error("推論結果為空，沒有輸出張量。");
+        }
         std::cerr << "推論結果為空，沒有輸出張量。" << std::endl;
         return {};
     }
@@ -177,6 +305,9 @@ std::vector<Detection> YOLOv12Inference::runInference(const cv::Mat& processed_i
     std::cout << "]" << std::endl; // 結束形狀輸出
 
     if (output_shape.size() != 3 || output_shape[0] != 1) {
+        if (throw_on_error) {
+            throw std::runtime_error("意外的輸出張量形狀。預期 3 個維度且批次大小為 1。");
+        }
         std::cerr << "意外的輸出張量形狀。預期 3 個維度且批次大小為 1，得到 "
                   << output_shape.size() << " 個維度，批次大小為 " << output_shape[0] << std::endl;
         // 如果輸出形狀與預期不符，打印詳細信息並返回空檢測
@@ -206,7 +337,42 @@ std::vector<Detection> YOLOv12Inference::runInference(const cv::Mat& processed_i
     // std::cout << "--------------------------------------------------\n" << std::endl;
     // ========================================================================
 
+    // 模型的類別數必須涵蓋所有啟用的類別
+    long num_model_classes = num_attributes - 4;
+    if (!_enabled_classes.empty() && _enabled_classes.back() >= num_model_classes) {
+        if (throw_on_error) {
+            throw std::runtime_error("模型輸出只有 " + std::to_string(num_model_classes) +
+                                     " 個類別，無法解碼類別 ID " + std::to_string(_enabled_classes.back()));
+        }
+        std::cerr << "模型輸出只有 " << num_model_classes << " 個類別，無法解碼類別 ID "
+                  << _enabled_classes.back() << std::endl;
+        return {};
+    }
+
+    // 逐個啟用類別掃描其分數列：輸出為 [1, attributes, num_boxes]，同一類別的分數在記憶體中連續，
+    // 循序讀取對快取友善，且解碼成本只與啟用的類別數成正比。
+    // 每個框只保留「超過該類別閾值」的最高分類別，沒有任何類別過閾值的框不會再讀取坐標
+    std::vector<float> best_scores(num_boxes, -1.0f);
+    std::vector<int> best_classes(num_boxes, -1);
+    for (size_t k = 0; k < _enabled_classes.size(); ++k) {
+        const int class_id = _enabled_classes[k];
+        const float threshold = _enabled_thresholds[k];
+        const float* class_scores = output_data + (4 + class_id) * num_boxes; // 類別分數從第 4 個屬性開始
+        for (long i = 0; i < num_boxes; ++i) {
+            float score = class_scores[i]; // 不應用 sigmoid，直接使用原始分數
+            if (score >= threshold && score > best_scores[i]) {
+                best_scores[i] = score;
+                best_classes[i] = class_id;
+            }
+        }
+    }
+
     for (long i = 0; i < num_boxes; ++i) {
+        int class_id = best_classes[i];
+        if (class_id < 0) {
+            continue; // 沒有任何啟用類別超過閾值
+        }
+
         // 從原始輸出數據中獲取 x1, y1, x2, y2 (YOLOv8 的 xyxy 格式)
         // 由於輸出格式是 [1, attributes, num_boxes]，數據是按列主序排列的
         float x1 = output_data[0 * num_boxes + i];
@@ -218,31 +384,13 @@ std::vector<Detection> YOLOv12Inference::runInference(const cv::Mat& processed_i
         float width = x2 - x1;
         float height = y2 - y1;
 
-        // 獲取所有類別分數，並找到最大分數及其對應的類別 ID
-        float max_score = -1.0f;
-        int class_id = -1;
-        // 類別分數從第 4 個屬性開始 (索引 4)
-        for (long j = 0; j < _class_names.size(); ++j) { // j 是類別索引
-            float score = output_data[(4 + j) * num_boxes + i];
-            // 不應用 sigmoid，直接使用原始分數
-            if (score > max_score) {
-                max_score = score;
-                class_id = j;
-            }
-        }
-
-        if (max_score >= _conf_threshold) {
-            Detection det;
-            // 使用 x1, y1, width, height 構造 cv::Rect2f
-            det.bbox = cv::Rect2f(x1, y1, width, height);
-            det.score = max_score;
-            if (class_id >= 0 && class_id < _class_names.size()) {
-                det.class_name = _class_names[class_id];
-            } else {
-                det.class_name = "Unknown";
-            }
-            detections.push_back(det);
-        }
+        Detection det;
+        // 使用 x1, y1, width, height 構造 cv::Rect2f
+        det.bbox = cv::Rect2f(x1, y1, width, height);
+        det.score = best_scores[i];
+        det.class_id = class_id;
+        det.class_name = _class_names[class_id];
+        detections.push_back(det);
     }
     return detections;
 }
\ No newline at end of file
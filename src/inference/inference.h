@@ -6,6 +6,9 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <string>
+#include <memory>
+#include <map>
+#include "../affinity/cpu_topology.h"
 
 // 如果 Detection 結構體沒有在其他通用頭文件中定義，請保留在這裡
 struct Detection {
@@ -15,13 +18,24 @@ struct Detection {
     std::string class_name;
 };
 
+// 類別過濾設定：只解碼啟用的類別，每個類別可有各自的置信度閾值
+struct ClassFilter {
+    std::vector<int> enabled_classes;      // 啟用的類別 ID；空代表全部類別
+    std::map<int, float> class_thresholds; // 個別類別的閾值；未列出的類別使用 conf_threshold
+
+    // 解析 "person:0.4,car,2:0.3" 格式的設定 (類別名稱或 ID，可選 :閾值)
+    // 無法辨識的項目會印出警告並略過
+    static ClassFilter parse(const std::string& spec, const std::vector<std::string>& class_names);
+};
+
 class YOLOv12Inference {
 public:
     // 建構函數
     YOLOv12Inference(const std::string& model_path,
                      const std::vector<std::string>& class_names,
                      const Ort::SessionOptions& session_options,
-                     float conf_threshold);
+                     float conf_threshold,
+                     const ClassFilter& class_filter = ClassFilter());
 
     // 解構函數
     ~YOLOv12Inference();
@@ -29,9 +43,23 @@ public:
     // 在預處理後的圖像上運行推論
     std::vector<Detection> runInference(const cv::Mat& processed_image);
 
+    // 以全零輸入執行數次推論，讓 ONNX Runtime 完成記憶體配置與 kernel 初始化，
+    // 避免第一個真實請求承擔冷啟動延遲。預熱推論不計入流程指標。
+    // 與 runInference 不同，推論失敗 (Run 拋出異常或輸出形狀不符) 時會拋出異常，
+    // 讓呼叫者拒絕能載入卻無法執行的模型
+    void warmup(int iterations = 1);
+
+    // 將輸出張量改寫入綁定在指定 NUMA 節點的預先配置緩衝區，避免每次 Run() 由 ORT 重新配置
+    // 只在輸出形狀為靜態時可用，否則回傳 false 並維持原本的配置方式。
+    // 綁定後輸出緩衝區由此實例獨占，同一實例不可在多個執行緒上同時呼叫 runInference
+    bool bindOutputToNode(int node);
+
     // 這些成員變數需要是 public 或提供 getter 函數，以便 main.cpp 訪問
     int64_t _input_height; // 模型期望的輸入高度
     int64_t _input_width;  // 模型期望的輸入寬度
+    std::vector<int64_t> _output_shape; // 模型宣告的輸出張量形狀 (動態維度為 -1)
+    ONNXTensorElementDataType _input_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;  // 輸入張量元素型別
+    ONNXTensorElementDataType _output_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED; // 輸出張量元素型別
 
 private:
     Ort::Env env;
@@ -42,10 +70,17 @@ private:
     std::vector<std::string> input_node_names;
     std::vector<std::string> output_node_names;
     float _conf_threshold; // 新增成員變數，用於儲存置信度閾值
+    std::vector<int> _enabled_classes;     // 解碼時掃描的類別 ID (遞增排列)
+    std::vector<float> _enabled_thresholds; // 與 _enabled_classes 對應的置信度閾值
+    std::unique_ptr<NumaBuffer> _output_buffer; // bindOutputToNode() 配置的輸出緩衝區
 
     // 輔助函數，用於獲取模型輸入/輸出資訊
     void get_model_info();
 
+    // runInference 的實作；record_metrics 為 false 時不寫入流程指標 (預熱用)，
+    // throw_on_error 為 true 時推論失敗會拋出異常，而不是記錄後回傳空結果
+    std::vector<Detection> infer(const cv::Mat& processed_image, bool record_metrics, bool throw_on_error);
+
 };
 
 #endif // YOLO_V12_INFERENCE_H
\ No newline at end of file
@@ -0,0 +1,230 @@
+// src/inference/model_handle.cpp
+#include "model_handle.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include "../utils/utils.h" // Timer
+#include "../metrics/metrics.h"
+#include "../affinity/cpu_topology.h" // AffinityScheduler
+
+namespace {
+
+// 將形狀格式化為 "[1, 84, 8400]" 以便輸出錯誤訊息
+std::string shapeToString(const std::vector<int64_t>& shape) {
+    std::string s = "[";
+    for (size_t i = 0; i < shape.size(); ++i) {
+        s += std::to_string(shape[i]);
+        if (i < shape.size() - 1) s += ", ";
+    }
+    return s + "]";
+}
+
+// 元素型別名稱，用於輸出錯誤訊息
+std::string elementTypeName(ONNXTensorElementDataType type) {
+    switch (type) {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT: return "float32";
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16: return "float16";
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE: return "float64";
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8: return "uint8";
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8: return "int8";
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32: return "int32";
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64: return "int64";
+    default: return "型別 " + std::to_string(static_cast<int>(type));
+    }
+}
+
+} // namespace
+
+// ModelHandle 類的建構函數
+ModelHandle::ModelHandle(const std::string& model_path,
+                         const std::vector<std::string>& class_names,
+                         const Ort::SessionOptions& session_options,
+                         float conf_threshold,
+                         const ClassFilter& class_filter,
+                         int warmup_iterations,
+                         const std::vector<std::vector<int>>& inference_cpu_sets)
+    : _class_names(class_names)
+    , _inference_cpu_sets(inference_cpu_sets)
+    , _conf_threshold(conf_threshold)
+    , _class_filter(class_filter)
+    , _warmup_iterations(warmup_iterations)
+    , _output_node(-1)
+    , _generation(0)
+    , _reloading(false)
+{
+    // 複製設定，背景載入時使用相同設定；ORT 的執行緒親和性在建立 Session 時固定，
+    // 因此每組 CPU 各準備一份，而不是在同一份設定上反覆改寫
+    if (_inference_cpu_sets.empty()) {
+        _session_options.push_back(session_options.Clone());
+    }
+    for (const auto& cpus : _inference_cpu_sets) {
+        Ort::SessionOptions options = session_options.Clone();
+        AffinityScheduler::configureSession(options, cpus);
+        _session_options.push_back(std::move(options));
+    }
+
+    // 初始模型 (第 0 代) 同步載入；載入失敗時 YOLOv12Inference 的建構函數會拋出異常
+    auto initial = std::make_shared<YOLOv12Inference>(model_path, _class_names, _session_options[0], _conf_threshold, _class_filter);
+    initial->warmup(_warmup_iterations);
+    std::atomic_store(&_current, std::move(initial));
+}
+
+// ModelHandle 類的解構函數
+ModelHandle::~ModelHandle() {
+    if (_loader.joinable()) {
+        _loader.join();
+    }
+}
+
+std::shared_ptr<YOLOv12Inference> ModelHandle::acquire() const {
+    return std::atomic_load(&_current);
+}
+
+void ModelHandle::bindOutputsToNode(int node) {
+    _output_node.store(node, std::memory_order_release);
+    acquire()->bindOutputToNode(node);
+}
+
+bool ModelHandle::reloadAsync(const std::string& model_path, SwapCallback on_complete) {
+    // 只允許一個背景載入；搶到旗標的呼叫者才能操作 _loader
+    bool expected = false;
+    if (!_reloading.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        return false;
+    }
+    if (_loader.joinable()) {
+        _loader.join(); // 上一次的載入執行緒已結束，回收它
+    }
+    _loader = std::thread([this, model_path, on_complete]() {
+        // ORT 的第 0 個 intra-op 執行緒是呼叫者：載入執行緒綁定到候選模型的那組 CPU，
+        // 預熱才不會佔用線上模型的核心 (載入執行緒預設繼承主執行緒的流程 CPU)
+        if (!_inference_cpu_sets.empty()) {
+            AffinityScheduler::pinCurrentThread(
+                _inference_cpu_sets[(generation() + 1) % _inference_cpu_sets.size()]);
+        }
+        ModelSwapReport report = reload(model_path);
+        if (on_complete) {
+            on_complete(report);
+        }
+        // 回呼結束後才清除旗標，避免回呼內再次呼叫 reloadAsync 時 join 自己
+        _reloading.store(false, std::memory_order_release);
+    });
+    return true;
+}
+
+ModelSwapReport ModelHandle::reload(const std::string& model_path) {
+    std::lock_guard<std::mutex> lock(_reload_mutex);
+
+    ModelSwapReport report;
+    report.model_path = model_path;
+
+    std::shared_ptr<YOLOv12Inference> candidate = loadCandidate(model_path, report);
+    if (!candidate) {
+        report.generation = generation();
+        std::cerr << "模型熱切換失敗 (" << model_path << "): " << report.error << std::endl;
+        pipelineMetrics().model_swap_failures.inc();
+        return report;
+    }
+
+    // 原子替換：之後的 acquire() 取得新模型，先前取得舊模型的請求不受影響
+    Timer swap_timer;
+    std::shared_ptr<YOLOv12Inference> previous = std::atomic_exchange(&_current, candidate);
+    report.generation = _generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+    report.swap_ms = swap_timer.elapsed_ms();
+    report.success = true;
+    pipelineMetrics().model_swaps.inc();
+
+    std::cout << "模型熱切換完成: " << model_path
+              << " (世代 " << report.generation
+              << ", 載入 " << report.load_ms << " ms"
+              << ", 預熱 " << report.warmup_ms << " ms"
+              << ", 切換 " << report.swap_ms << " ms)" << std::endl;
+
+    // previous 在此釋放本執行緒的引用；若仍有請求持有舊模型，舊 Session 會在它們完成後才銷毀
+    return report;
+}
+
+std::shared_ptr<YOLOv12Inference> ModelHandle::loadCandidate(const std::string& model_path,
+                                                             ModelSwapReport& report) {
+    std::shared_ptr<YOLOv12Inference> candidate;
+
+    Timer load_timer;
+    try {
+        candidate = std::make_shared<YOLOv12Inference>(model_path, _class_names, candidateSessionOptions(),
+                                                       _conf_threshold, _class_filter);
+    } catch (const std::exception& e) { // Ort::Exception 亦繼承自 std::exception
+        report.error = std::string("載入模型失敗: ") + e.what();
+        return nullptr;
+    }
+    report.load_ms = load_timer.elapsed_ms();
+
+    // 先檢查形狀與型別再預熱，不相容的模型不必浪費預熱時間
+    std::shared_ptr<YOLOv12Inference> current = acquire();
+    std::string mismatch = checkCompatibility(*current, *candidate);
+    if (!mismatch.empty()) {
+        report.error = "模型不相容: " + mismatch;
+        return nullptr;
+    }
+
+    // 預熱前綁定輸出緩衝區，預熱同時完成頁面配置
+    int output_node = _output_node.load(std::memory_order_acquire);
+    if (output_node >= 0) {
+        candidate->bindOutputToNode(output_node);
+    }
+
+    // 預熱時推論失敗會拋出異常 (例如不支援的運算子、CUDA 記憶體不足)，
+    // 能載入卻無法執行的模型在此被拒絕，不會切換上線後每幀都回傳空結果；
+    // 即使設定為不預熱也至少執行一次，作為切換前的驗證
+    Timer warmup_timer;
+    try {
+        candidate->warmup(std::max(_warmup_iterations, 1));
+    } catch (const std::exception& e) {
+        report.error = std::string("預熱推論失敗: ") + e.what();
+        return nullptr;
+    }
+    report.warmup_ms = warmup_timer.elapsed_ms();
+
+    return candidate;
+}
+
+const Ort::SessionOptions& ModelHandle::candidateSessionOptions() const {
+    // 兩組 CPU 時候選模型使用線上模型沒有用到的那一組，切換後下一個候選再換回另一組
+    return _session_options[(generation() + 1) % _session_options.size()];
+}
+
+std::string ModelHandle::checkCompatibility(const YOLOv12Inference& current,
+                                            const YOLOv12Inference& candidate) const {
+    // 輸入尺寸必須一致，否則已排入佇列、以舊尺寸 letterbox 的影格無法直接送入新模型
+    if (current._input_height != candidate._input_height ||
+        current._input_width != candidate._input_width) {
+        return "輸入尺寸 (H, W) 由 (" + std::to_string(current._input_height) + ", " +
+               std::to_string(current._input_width) + ") 變為 (" +
+               std::to_string(candidate._input_height) + ", " +
+               std::to_string(candidate._input_width) + ")";
+    }
+
+    // 元素型別必須一致：前處理只產生 float32 輸入，解碼器以 float 讀取輸出
+    if (current._input_type != candidate._input_type) {
+        return "輸入元素型別由 " + elementTypeName(current._input_type) +
+               " 變為 " + elementTypeName(candidate._input_type);
+    }
+    if (current._output_type != candidate._output_type) {
+        return "輸出元素型別由 " + elementTypeName(current._output_type) +
+               " 變為 " + elementTypeName(candidate._output_type);
+    }
+
+    // 輸出形狀必須一致 (動態維度 -1 也必須對應)，解碼器依賴 [1, 4 + 類別數, 框數] 的排列
+    if (current._output_shape != candidate._output_shape) {
+        return "輸出形狀由 " + shapeToString(current._output_shape) +
+               " 變為 " + shapeToString(candidate._output_shape);
+    }
+
+    // 屬性數量 (第 1 維) 必須等於 4 個坐標加上類別數
+    const std::vector<int64_t>& shape = candidate._output_shape;
+    if (shape.size() == 3 && shape[1] > 0 &&
+        shape[1] != static_cast<int64_t>(4 + _class_names.size())) {
+        return "輸出屬性數量 " + std::to_string(shape[1]) + " 與類別數 " +
+               std::to_string(_class_names.size()) + " 不符";
+    }
+
+    return "";
+}
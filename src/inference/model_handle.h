@@ -0,0 +1,102 @@
+// src/inference/model_handle.h
+#ifndef YOLO_MODEL_HANDLE_H
+#define YOLO_MODEL_HANDLE_H
+
+#include <onnxruntime_cxx_api.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "inference.h"
+
+// 一次模型熱切換的結果報告
+struct ModelSwapReport {
+    bool success = false;      // 是否已切換到新模型
+    std::string model_path;    // 新模型路徑
+    uint64_t generation = 0;   // 切換後的模型世代編號 (失敗時為目前世代)
+    double load_ms = 0.0;      // 建立 Session 並讀取模型資訊的時間
+    double warmup_ms = 0.0;    // 預熱推論的時間
+    double swap_ms = 0.0;      // 原子替換指標的時間
+    std::string error;         // 失敗原因 (載入錯誤、形狀/型別不相容或預熱推論失敗)
+};
+
+// 可熱切換的模型句柄 (RCU 風格)
+// 推論端每次請求透過 acquire() 取得目前模型的 shared_ptr，
+// 背景執行緒載入並預熱新模型後，以原子操作替換指標。
+// 已取得舊模型的請求會在舊 Session 上完成，最後一個持有者釋放時舊模型才被銷毀。
+class ModelHandle {
+public:
+    using SwapCallback = std::function<void(const ModelSwapReport&)>;
+
+    // 建構函數：同步載入初始模型並預熱
+    // inference_cpu_sets 非空時，第 g 代模型的 Session 以 session_options 的複本加上
+    // 第 g % size() 組 CPU 的 intra-op 親和性建立 (參見 AffinityScheduler::configureSession)。
+    // 給兩組互不重疊的 CPU 時，熱切換的候選模型與線上模型的工作執行緒不會落在同一組核心上；
+    // 只給一組時兩者共用該組核心，預熱期間會與線上推論互搶；為空時直接使用 session_options
+    ModelHandle(const std::string& model_path,
+                const std::vector<std::string>& class_names,
+                const Ort::SessionOptions& session_options,
+                float conf_threshold,
+                const ClassFilter& class_filter = ClassFilter(),
+                int warmup_iterations = 1,
+                const std::vector<std::vector<int>>& inference_cpu_sets = {});
+
+    // 解構函數：等待尚在進行中的背景載入結束
+    ~ModelHandle();
+
+    ModelHandle(const ModelHandle&) = delete;
+    ModelHandle& operator=(const ModelHandle&) = delete;
+
+    // 取得目前模型；回傳的指標在持有期間保證有效，即使期間發生切換
+    std::shared_ptr<YOLOv12Inference> acquire() const;
+
+    // 在背景執行緒載入、預熱並切換到新模型，完成後呼叫 on_complete
+    // 若已有一個載入正在進行，回傳 false 且不做任何事
+    bool reloadAsync(const std::string& model_path, SwapCallback on_complete = nullptr);
+
+    // 同步版本：在呼叫者執行緒上載入並切換
+    ModelSwapReport reload(const std::string& model_path);
+
+    // 是否有背景載入正在進行
+    bool isReloading() const { return _reloading.load(std::memory_order_acquire); }
+
+    // 之後載入的每個模型都把輸出緩衝區綁定到 node (參見 YOLOv12Inference::bindOutputToNode)，
+    // 並立即套用到目前模型；必須在開始推論前呼叫
+    void bindOutputsToNode(int node);
+
+    // 目前模型的世代編號，每次成功切換加一
+    uint64_t generation() const { return _generation.load(std::memory_order_acquire); }
+
+private:
+    // 載入新模型、檢查相容性並預熱；成功時回傳新模型，失敗時於 report.error 說明原因
+    std::shared_ptr<YOLOv12Inference> loadCandidate(const std::string& model_path,
+                                                    ModelSwapReport& report);
+
+    // 檢查候選模型的輸入/輸出形狀與元素型別是否與目前模型相容，不相容時回傳說明字串
+    std::string checkCompatibility(const YOLOv12Inference& current,
+                                   const YOLOv12Inference& candidate) const;
+
+    // 候選模型的 Session 設定 (第 generation + 1 代)；呼叫者須持有 _reload_mutex
+    const Ort::SessionOptions& candidateSessionOptions() const;
+
+    std::vector<std::string> _class_names;
+    std::vector<Ort::SessionOptions> _session_options;     // 每組推論 CPU 一份設定，第 g 代使用第 g % size() 份
+    std::vector<std::vector<int>> _inference_cpu_sets;     // 與 _session_options 對應；空代表不綁定
+    float _conf_threshold;
+    ClassFilter _class_filter;
+    int _warmup_iterations;
+    std::atomic<int> _output_node; // -1 表示不綁定
+
+    std::shared_ptr<YOLOv12Inference> _current; // 只透過 std::atomic_load/atomic_store 存取
+    std::atomic<uint64_t> _generation;
+
+    std::mutex _reload_mutex;       // 序列化 reload()，避免兩次切換交錯
+    std::thread _loader;            // 背景載入執行緒
+    std::atomic<bool> _reloading;
+};
+
+#endif // YOLO_MODEL_HANDLE_H
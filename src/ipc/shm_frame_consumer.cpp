@@ -0,0 +1,187 @@
+// src/ipc/shm_frame_consumer.cpp
+#include "shm_frame_consumer.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// 擷取端在 ftruncate 之後、寫入 magic 之前的初始化時間很短，等待此時間後仍未完成才視為錯誤
+const int kInitRetries = 100;
+const std::chrono::milliseconds kInitRetryInterval(10);
+
+// 單邊尺寸上限：避免異常標頭讓大小計算溢位，也保證可放進 cv::Mat 的 int 尺寸
+const uint32_t kMaxFrameDimension = 1u << 15;
+
+} // namespace
+
+// ShmFrameConsumer 類的建構函數
+ShmFrameConsumer::ShmFrameConsumer(const std::string& name)
+    : _name(name)
+    , _region_size(0)
+    , _region(nullptr)
+    , _header(nullptr)
+    , _width(0)
+    , _height(0)
+    , _stride(0)
+    , _slot_count(0)
+    , _slot_bytes(0)
+    , _slots_offset(0)
+    , _next_expected(0)
+    , _skipped(0)
+    , _device(0)
+    , _inode(0)
+{
+    int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("無法開啟共享記憶體 (" + _name + "): " + std::strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+        close(fd);
+        throw std::runtime_error("共享記憶體 (" + _name + ") 尚未初始化。");
+    }
+    _region_size = static_cast<size_t>(st.st_size);
+    _device = st.st_dev;
+    _inode = st.st_ino;
+    // 讀取端只需唯讀映射；序號計數器的 load 不需要寫入權限
+    _region = mmap(nullptr, _region_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (_region == MAP_FAILED) {
+        _region = nullptr;
+        throw std::runtime_error("mmap 失敗 (" + _name + "): " + std::strerror(errno));
+    }
+    _header = static_cast<const ShmRingHeader*>(_region);
+
+    // magic 由擷取端在其餘欄位初始化完成後最後寫入：先讀 magic，再以 acquire fence
+    // 與擷取端的 release fence 配對，之後讀到的標頭欄位才保證完整。
+    // magic 仍為 0 代表擷取端尚未完成初始化，稍候重試
+    uint32_t magic = 0;
+    for (int attempt = 0; attempt < kInitRetries; ++attempt) {
+        magic = *reinterpret_cast<const volatile uint32_t*>(&_header->magic);
+        if (magic != 0) break;
+        std::this_thread::sleep_for(kInitRetryInterval);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (magic == 0) {
+        munmap(_region, _region_size);
+        _region = nullptr;
+        throw std::runtime_error("共享記憶體 (" + _name + ") 尚未初始化。");
+    }
+    if (magic != kShmFrameMagic || _header->version != kShmFrameVersion) {
+        munmap(_region, _region_size);
+        _region = nullptr;
+        throw std::runtime_error("共享記憶體 (" + _name + ") 的格式或版本不符。");
+    }
+
+    // 讀取時的 slot 位址與 cv::Mat 的 step 都由這些欄位決定，錯誤或過期的標頭會讓讀取超出映射範圍：
+    // 每個欄位都必須等於協定依寬高計算出的值
+    _width = _header->width;
+    _height = _header->height;
+    _stride = _header->stride;
+    _slot_count = _header->slot_count;
+    _slot_bytes = _header->slot_bytes;
+    _slots_offset = _header->slots_offset;
+    std::string layout_error;
+    if (_width == 0 || _height == 0 || _width > kMaxFrameDimension || _height > kMaxFrameDimension) {
+        layout_error = "影格尺寸 " + std::to_string(_width) + "x" + std::to_string(_height) + " 無效";
+    } else if (_slot_count < 2 || _slot_count > kMaxFrameDimension) {
+        layout_error = "slot 數量 " + std::to_string(_slot_count) + " 無效";
+    } else {
+        uint64_t expected_slot_bytes = 0;
+        uint64_t expected_slots_offset = 0;
+        size_t expected_size = shmRegionSize(_width, _height, _slot_count, &expected_slot_bytes, &expected_slots_offset);
+        if (_stride != shmRowStride(_width)) {
+            layout_error = "stride " + std::to_string(_stride) + " 應為 " + std::to_string(shmRowStride(_width));
+        } else if (_slot_bytes != expected_slot_bytes) {
+            layout_error = "slot 大小 " + std::to_string(_slot_bytes) + " 應為 " + std::to_string(expected_slot_bytes);
+        } else if (_slots_offset != expected_slots_offset) {
+            layout_error = "slot 偏移 " + std::to_string(_slots_offset) + " 應為 " + std::to_string(expected_slots_offset);
+        } else if (_region_size < expected_size) {
+            layout_error = "大小 " + std::to_string(_region_size) + " 小於標頭描述的 " + std::to_string(expected_size);
+        }
+    }
+    if (!layout_error.empty()) {
+        munmap(_region, _region_size);
+        _region = nullptr;
+        throw std::runtime_error("共享記憶體 (" + _name + ") 的布局與標頭描述不符: " + layout_error);
+    }
+
+    std::cout << "已連接共享記憶體影格來源: " << _name << " (" << _width << "x" << _height
+              << ", " << _slot_count << " slots)" << std::endl;
+}
+
+// ShmFrameConsumer 類的解構函數
+ShmFrameConsumer::~ShmFrameConsumer() {
+    if (_region) {
+        munmap(_region, _region_size);
+    }
+}
+
+bool ShmFrameConsumer::acquireLatest(ShmFrameView& view) {
+    uint64_t published = _header->write_index.load(std::memory_order_acquire);
+    if (published == 0 || published <= _next_expected) {
+        return false; // 沒有新影格
+    }
+    uint64_t frame_number = published - 1;
+
+    ShmSlotHeader* slot = slotFor(frame_number);
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+        return false; // 擷取端正在覆寫此 slot
+    }
+    uint64_t slot_frame = slot->frame_number;
+    int64_t capture_time_ns = slot->capture_time_ns;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != sequence || slot_frame != frame_number) {
+        return false; // 讀取標頭期間被覆寫，下次再取更新的影格
+    }
+
+    _skipped += frame_number - _next_expected;
+    _next_expected = frame_number + 1;
+
+    // 只建立 cv::Mat 標頭指向共享記憶體，不複製像素
+    view.image = cv::Mat(static_cast<int>(_height), static_cast<int>(_width), CV_8UC3,
+                         shmSlotPixels(slot), _stride);
+    view.frame_number = frame_number;
+    view.capture_time_ns = capture_time_ns;
+    view.sequence = sequence;
+    view.slot = slot;
+    return true;
+}
+
+ShmSlotHeader* ShmFrameConsumer::slotFor(uint64_t frame_number) const {
+    uint8_t* region = static_cast<uint8_t*>(_region);
+    return reinterpret_cast<ShmSlotHeader*>(region + _slots_offset + (frame_number % _slot_count) * _slot_bytes);
+}
+
+bool ShmFrameConsumer::hasNewerFrame(const ShmFrameView& view) const {
+    return _header->write_index.load(std::memory_order_acquire) > view.frame_number + 1;
+}
+
+bool ShmFrameConsumer::sourceReplaced() const {
+    int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return true; // 名稱已被移除
+    }
+    struct stat st;
+    bool replaced = fstat(fd, &st) != 0 || st.st_dev != _device || st.st_ino != _inode;
+    close(fd);
+    return replaced;
+}
+
+bool ShmFrameConsumer::isValid(const ShmFrameView& view) const {
+    if (!view.slot) {
+        return false;
+    }
+    // 確保先前對像素的讀取不會被重排到序號檢查之後
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.slot->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
@@ -0,0 +1,74 @@
+// src/ipc/shm_frame_consumer.h
+#ifndef YOLO_SHM_FRAME_CONSUMER_H
+#define YOLO_SHM_FRAME_CONSUMER_H
+
+#include <sys/types.h>
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "shm_frame_protocol.h"
+
+// 共享記憶體中一幀的唯讀視圖；image 只是包住 slot 像素的 cv::Mat 標頭，不複製資料
+struct ShmFrameView {
+    cv::Mat image;              // CV_8UC3，資料位於共享記憶體，不可寫入
+    uint64_t frame_number = 0;
+    int64_t capture_time_ns = 0; // CLOCK_MONOTONIC，與 std::chrono::steady_clock 同源
+    uint64_t sequence = 0;       // 取得時的 slot 序號，用於 isValid()
+    const ShmSlotHeader* slot = nullptr;
+};
+
+// 偵測程序端：唯讀映射擷取程序建立的共享記憶體，取得最新影格的零複製視圖
+class ShmFrameConsumer {
+public:
+    // 開啟名為 name 的共享記憶體；不存在、擷取端尚未完成初始化 (短暫重試後) 或布局不符時
+    // 拋出 std::runtime_error。標頭中的尺寸、stride、slot 大小與偏移都必須等於協定依寬高計算的值，
+    // 驗證後複製一份使用，之後不再信任共享記憶體中的布局欄位
+    explicit ShmFrameConsumer(const std::string& name);
+    ~ShmFrameConsumer();
+
+    ShmFrameConsumer(const ShmFrameConsumer&) = delete;
+    ShmFrameConsumer& operator=(const ShmFrameConsumer&) = delete;
+
+    // 取得尚未處理過的最新影格；沒有新影格或該 slot 正在寫入時回傳 false
+    bool acquireLatest(ShmFrameView& view);
+
+    // 檢查視圖的 slot 從取得至今是否未被覆寫；
+    // 使用 view.image 的結果 (例如 letterbox 的輸出) 必須在此檢查通過後才可信
+    bool isValid(const ShmFrameView& view) const;
+
+    // 已發布但因讀取端較慢而被跳過的影格數
+    uint64_t skippedFrames() const { return _skipped; }
+
+    // 在 view 之後是否已有更新的影格發布
+    bool hasNewerFrame(const ShmFrameView& view) const;
+
+    // 名稱 name 是否已不再指向目前映射的共享記憶體 (擷取端重新啟動並重建，或已移除)；
+    // 需要 shm_open/fstat 系統呼叫，只在長時間沒有新影格時檢查
+    bool sourceReplaced() const;
+
+    uint32_t width() const { return _width; }
+    uint32_t height() const { return _height; }
+
+private:
+    // 依驗證過的布局取得 frame_number 所在的 slot
+    ShmSlotHeader* slotFor(uint64_t frame_number) const;
+
+    std::string _name;
+    size_t _region_size;
+    void* _region;
+    const ShmRingHeader* _header;
+    // 開啟時驗證過的布局 (複製自標頭)
+    uint32_t _width;
+    uint32_t _height;
+    uint32_t _stride;
+    uint32_t _slot_count;
+    uint64_t _slot_bytes;
+    uint64_t _slots_offset;
+    uint64_t _next_expected; // 下一個預期的影格編號，用於計算跳過數
+    uint64_t _skipped;
+    dev_t _device;           // 開啟時的裝置與 inode，用於判斷共享記憶體是否被重建
+    ino_t _inode;
+};
+
+#endif // YOLO_SHM_FRAME_CONSUMER_H
@@ -0,0 +1,133 @@
+// src/ipc/shm_frame_producer.cpp
+#include "shm_frame_producer.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+
+namespace {
+
+int64_t monotonicNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+} // namespace
+
+// ShmFrameProducer 類的建構函數
+ShmFrameProducer::ShmFrameProducer(const std::string& name, uint32_t width, uint32_t height, uint32_t slot_count)
+    : _name(name)
+    , _width(width)
+    , _height(height)
+    , _stride(shmRowStride(width))
+    , _region_size(0)
+    , _region(nullptr)
+    , _header(nullptr)
+    , _writing_slot(nullptr)
+    , _next_frame(0)
+{
+    if (width == 0 || height == 0 || slot_count < 2) {
+        throw std::runtime_error("共享記憶體影格尺寸必須為正，且至少需要 2 個 slot。");
+    }
+
+    uint64_t slot_bytes = 0;
+    uint64_t slots_offset = 0;
+    _region_size = shmRegionSize(width, height, slot_count, &slot_bytes, &slots_offset);
+
+    // 移除上次異常結束時殘留的同名共享記憶體，避免讀到舊的布局
+    shm_unlink(_name.c_str());
+    int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0) {
+        throw std::runtime_error("shm_open 失敗 (" + _name + "): " + std::strerror(errno));
+    }
+    if (ftruncate(fd, static_cast<off_t>(_region_size)) != 0) {
+        std::string error = std::strerror(errno);
+        close(fd);
+        shm_unlink(_name.c_str());
+        throw std::runtime_error("ftruncate 失敗 (" + _name + "): " + error);
+    }
+    _region = mmap(nullptr, _region_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // 映射建立後即可關閉檔案描述符
+    if (_region == MAP_FAILED) {
+        _region = nullptr;
+        shm_unlink(_name.c_str());
+        throw std::runtime_error("mmap 失敗 (" + _name + "): " + std::strerror(errno));
+    }
+
+    // 在共享記憶體上建構標頭與每個 slot 的原子計數器
+    _header = new (_region) ShmRingHeader();
+    _header->version = kShmFrameVersion;
+    _header->slot_count = slot_count;
+    _header->width = width;
+    _header->height = height;
+    _header->stride = _stride;
+    _header->slot_bytes = slot_bytes;
+    _header->slots_offset = slots_offset;
+    _header->write_index.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slot_count; ++i) {
+        ShmSlotHeader* slot = new (shmSlot(_region, *_header, i)) ShmSlotHeader();
+        slot->sequence.store(0, std::memory_order_relaxed);
+        slot->frame_number = 0;
+        slot->capture_time_ns = 0;
+    }
+    // magic 最後寫入：讀取端看到 magic 時其餘欄位已初始化完成
+    std::atomic_thread_fence(std::memory_order_release);
+    _header->magic = kShmFrameMagic;
+}
+
+// ShmFrameProducer 類的解構函數
+ShmFrameProducer::~ShmFrameProducer() {
+    if (_region) {
+        munmap(_region, _region_size);
+        shm_unlink(_name.c_str()); // 已映射的讀取端仍可繼續使用，直到它們解除映射
+    }
+}
+
+uint8_t* ShmFrameProducer::beginFrame() {
+    _writing_slot = shmSlot(_region, *_header, _next_frame);
+    // seqlock 寫入端：先把序號變為奇數，讀取端看到奇數或序號變動即知此 slot 已失效
+    uint64_t sequence = _writing_slot->sequence.load(std::memory_order_relaxed);
+    _writing_slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return shmSlotPixels(_writing_slot);
+}
+
+uint64_t ShmFrameProducer::commitFrame(int64_t capture_time_ns) {
+    if (!_writing_slot) {
+        throw std::logic_error("commitFrame() 必須在 beginFrame() 之後呼叫。");
+    }
+    uint64_t frame_number = _next_frame++;
+    _writing_slot->frame_number = frame_number;
+    _writing_slot->capture_time_ns = capture_time_ns != 0 ? capture_time_ns : monotonicNowNs();
+
+    // 序號回到偶數，並發布新的 write_index
+    uint64_t sequence = _writing_slot->sequence.load(std::memory_order_relaxed);
+    _writing_slot->sequence.store(sequence + 1, std::memory_order_release);
+    _header->write_index.store(frame_number + 1, std::memory_order_release);
+    _writing_slot = nullptr;
+    return frame_number;
+}
+
+void ShmFrameProducer::abortFrame() {
+    if (!_writing_slot) {
+        return;
+    }
+    // 序號回到偶數但不更新 write_index；先前取得此 slot 的讀取端會因序號改變而失效
+    uint64_t sequence = _writing_slot->sequence.load(std::memory_order_relaxed);
+    _writing_slot->sequence.store(sequence + 1, std::memory_order_release);
+    _writing_slot = nullptr;
+}
+
+uint64_t ShmFrameProducer::publish(const uint8_t* src, size_t src_stride, int64_t capture_time_ns) {
+    uint8_t* dst = beginFrame();
+    size_t row_bytes = static_cast<size_t>(_width) * kShmFrameChannels;
+    for (uint32_t y = 0; y < _height; ++y) {
+        std::memcpy(dst + static_cast<size_t>(y) * _stride, src + y * src_stride, row_bytes);
+    }
+    return commitFrame(capture_time_ns);
+}
@@ -0,0 +1,53 @@
+// src/ipc/shm_frame_producer.h
+#ifndef YOLO_SHM_FRAME_PRODUCER_H
+#define YOLO_SHM_FRAME_PRODUCER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "shm_frame_protocol.h"
+
+// 擷取程序端：建立 POSIX 共享記憶體環形緩衝區並發布原始 BGR 影格。
+// 不依賴 OpenCV；擷取程式可以直接把解碼結果寫進 slot，整個流程只寫入一次。
+class ShmFrameProducer {
+public:
+    // 建立 (或重新建立) 名為 name 的共享記憶體，例如 "/yolo_frames"
+    // 失敗時拋出 std::runtime_error
+    ShmFrameProducer(const std::string& name, uint32_t width, uint32_t height, uint32_t slot_count = 4);
+
+    // 解構函數：解除映射並移除共享記憶體名稱
+    ~ShmFrameProducer();
+
+    ShmFrameProducer(const ShmFrameProducer&) = delete;
+    ShmFrameProducer& operator=(const ShmFrameProducer&) = delete;
+
+    // 取得下一個 slot 的像素指標 (height 列，每列 stride() bytes) 並標記為寫入中
+    uint8_t* beginFrame();
+
+    // 完成 beginFrame() 取得的影格並發布，回傳影格編號
+    // capture_time_ns 為 CLOCK_MONOTONIC 時間；傳 0 則使用目前時間
+    uint64_t commitFrame(int64_t capture_time_ns = 0);
+
+    // 放棄 beginFrame() 取得的影格；slot 內容已不可信，但不會被發布
+    void abortFrame();
+
+    // 便利函數：從 src (每列 src_stride bytes) 複製一幀並發布
+    uint64_t publish(const uint8_t* src, size_t src_stride, int64_t capture_time_ns = 0);
+
+    uint32_t width() const { return _width; }
+    uint32_t height() const { return _height; }
+    uint32_t stride() const { return _stride; }
+
+private:
+    std::string _name;
+    uint32_t _width;
+    uint32_t _height;
+    uint32_t _stride;
+    size_t _region_size;
+    void* _region;
+    ShmRingHeader* _header;
+    ShmSlotHeader* _writing_slot; // beginFrame() 與 commitFrame() 之間的 slot
+    uint64_t _next_frame;
+};
+
+#endif // YOLO_SHM_FRAME_PRODUCER_H
@@ -0,0 +1,76 @@
+// src/ipc/shm_frame_protocol.h
+// 擷取程序與偵測程序之間共享記憶體影格環形緩衝區的記憶體布局。
+// 本檔案不依賴 OpenCV，擷取端只需要此檔案與 shm_frame_producer.h。
+//
+// 布局: [ShmRingHeader][slot 0][slot 1]...[slot N-1]
+// 每個 slot: [ShmSlotHeader][BGR 像素資料 (height * stride bytes)]
+//
+// 每個 slot 以 seqlock 保護：寫入前 sequence 變為奇數，寫完變為下一個偶數。
+// 讀取端在讀取前後比較 sequence，相同且為偶數代表期間沒有被覆寫。
+#ifndef YOLO_SHM_FRAME_PROTOCOL_H
+#define YOLO_SHM_FRAME_PROTOCOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+const uint32_t kShmFrameMagic = 0x4F4C4F59;  // "YOLO"
+const uint32_t kShmFrameVersion = 1;
+const uint32_t kShmFrameChannels = 3;        // 只支援 8-bit BGR
+const size_t kShmCacheLine = 64;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "共享記憶體中的序號計數器必須是 lock-free 的 64 位元原子變數");
+
+// 環形緩衝區標頭，位於共享記憶體開頭
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;       // 每列位元組數 (width * 3，對齊到 64 bytes)
+    uint64_t slot_bytes;   // 每個 slot 佔用的位元組數 (含 slot 標頭)
+    uint64_t slots_offset; // 第一個 slot 相對於共享記憶體開頭的偏移
+
+    // 已發布的影格數；最新影格編號為 write_index - 1
+    alignas(kShmCacheLine) std::atomic<uint64_t> write_index;
+};
+
+// 每個 slot 的標頭；像素資料緊接在後
+struct alignas(kShmCacheLine) ShmSlotHeader {
+    std::atomic<uint64_t> sequence; // seqlock 序號：奇數代表寫入中
+    uint64_t frame_number;          // 此 slot 目前保存的影格編號
+    int64_t capture_time_ns;        // CLOCK_MONOTONIC 擷取時間，跨程序可比較
+};
+
+inline size_t shmAlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// 依影格尺寸計算每列位元組數
+inline uint32_t shmRowStride(uint32_t width) {
+    return static_cast<uint32_t>(shmAlignUp(static_cast<size_t>(width) * kShmFrameChannels, kShmCacheLine));
+}
+
+// 計算整塊共享記憶體所需大小
+inline size_t shmRegionSize(uint32_t width, uint32_t height, uint32_t slot_count,
+                            uint64_t* slot_bytes_out = nullptr, uint64_t* slots_offset_out = nullptr) {
+    size_t slots_offset = shmAlignUp(sizeof(ShmRingHeader), 4096);
+    size_t slot_bytes = shmAlignUp(sizeof(ShmSlotHeader) + static_cast<size_t>(shmRowStride(width)) * height, 4096);
+    if (slot_bytes_out) *slot_bytes_out = slot_bytes;
+    if (slots_offset_out) *slots_offset_out = slots_offset;
+    return slots_offset + slot_bytes * slot_count;
+}
+
+inline ShmSlotHeader* shmSlot(void* base, const ShmRingHeader& header, uint64_t frame_number) {
+    uint8_t* region = static_cast<uint8_t*>(base);
+    return reinterpret_cast<ShmSlotHeader*>(region + header.slots_offset +
+                                            (frame_number % header.slot_count) * header.slot_bytes);
+}
+
+inline uint8_t* shmSlotPixels(ShmSlotHeader* slot) {
+    return reinterpret_cast<uint8_t*>(slot) + sizeof(ShmSlotHeader);
+}
+
+#endif // YOLO_SHM_FRAME_PROTOCOL_H
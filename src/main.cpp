@@ -2,21 +2,408 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
 #include <opencv2/opencv.hpp>
 
 // 引入所有模塊的頭文件
 #include "preprocess/preprocess.h"
 #include "inference/inference.h"
+#include "inference/model_handle.h"
 #include "postprocess/postprocess.h"
 #include "utils/utils.h"
+#include "realtime/realtime_ingest.h"
+#include "ipc/shm_frame_consumer.h"
+#include "metrics/metrics.h"
+#include "affinity/cpu_topology.h"
 
 // 定義模型輸入尺寸和閾值
 const float CONF_THRESHOLD = 0.25f; // 置信度閾值
 const float NMS_THRESHOLD = 0.45f;  // NMS 閾值
 
+// 收到 SIGHUP 時設為 true，串流迴圈據此在背景重新載入模型檔
+static std::atomic<bool> g_reload_requested(false);
+
+static void onReloadSignal(int) {
+    g_reload_requested.store(true);
+}
+
+// 收到 SIGINT/SIGTERM 時設為 true，串流迴圈據此正常結束，讓 ModelHandle 與指標伺服器完成解構
+static std::atomic<bool> g_stop_requested(false);
+
+static void onStopSignal(int) {
+    g_stop_requested.store(true);
+}
+
+// 執行緒配置 (YOLO_PIN_THREADS=1 時啟用)，各組 CPU 位於同一 NUMA 節點且互不重疊：
+//   capture   擷取執行緒
+//   pipeline  主執行緒 (前/後處理、OpenCV 內部平行化、ORT 第 0 個 intra-op 執行緒)
+//   inference / inference-standby
+//             ORT 其餘 intra-op 執行緒。節點剩下的 CPU 以實體核心為單位分成兩組，
+//             模型熱切換時新舊 Session 輪流使用 (第 g 代使用第 g % 2 組)，候選模型的載入與預熱
+//             (含背景載入執行緒本身) 不會與線上推論搶核心；代價是任一時刻線上模型只用到其中一組。
+//             剩下不到兩個實體核心時不分組，熱切換期間新舊 Session 共用同一組 CPU
+struct ThreadPlacement {
+    int node = -1; // -1 表示未啟用
+    std::vector<int> capture_cpus;
+    std::vector<int> pipeline_cpus;
+    std::vector<int> inference_cpus;         // 初始模型 (第 0 代) 的 intra-op CPU
+    std::vector<int> standby_inference_cpus; // 第 1 代的 intra-op CPU；空代表不分組
+
+    // 交給 ModelHandle 的推論 CPU 組；未啟用時為空
+    std::vector<std::vector<int>> inferenceCpuSets() const {
+        std::vector<std::vector<int>> sets;
+        if (node < 0) return sets;
+        sets.push_back(inference_cpus);
+        if (!standby_inference_cpus.empty()) sets.push_back(standby_inference_cpus);
+        return sets;
+    }
+};
+
+// 依 CPU 拓撲規劃並套用執行緒配置；需在建立 ModelHandle 之前呼叫
+static ThreadPlacement planThreadPlacement() {
+    ThreadPlacement placement;
+    const char* pin_threads = std::getenv("YOLO_PIN_THREADS");
+    if (!pin_threads || std::string(pin_threads) != "1") {
+        return placement;
+    }
+
+    CpuTopology topology = CpuTopology::discover();
+    topology.print();
+    if (topology.nodes.empty()) {
+        return placement;
+    }
+    // 整個流程放在 CPU 最多的節點上，影格與張量不必跨插槽存取
+    const NumaNode* node = &topology.nodes[0];
+    for (const auto& n : topology.nodes) {
+        if (n.cpus.size() > node->cpus.size()) node = &n;
+    }
+    placement.node = node->id;
+
+    AffinityScheduler scheduler(topology);
+    size_t node_cpus = node->cpus.size();
+    if (node_cpus >= 4) {
+        placement.capture_cpus = scheduler.reserve("capture", 1, node->id);
+    }
+    placement.pipeline_cpus = scheduler.reserve("pipeline", node_cpus >= 8 ? 2 : 1, node->id);
+    std::vector<int> remaining = scheduler.reserveRemaining("inference", node->id);
+    std::pair<std::vector<int>, std::vector<int>> halves = splitByPhysicalCore(remaining);
+    placement.inference_cpus = halves.first;
+    placement.standby_inference_cpus = halves.second;
+    std::cout << "執行緒配置 (node" << node->id << "):" << std::endl;
+    scheduler.print();
+    if (!placement.standby_inference_cpus.empty()) {
+        std::cout << "  推論 CPU 分為兩組，熱切換時新舊模型輪流使用:" << std::endl;
+        std::cout << "    A:";
+        for (int cpu : placement.inference_cpus) std::cout << " " << cpu;
+        std::cout << std::endl << "    B:";
+        for (int cpu : placement.standby_inference_cpus) std::cout << " " << cpu;
+        std::cout << std::endl;
+    } else {
+        std::cout << "  推論 CPU 不足兩個實體核心，熱切換期間新舊模型共用推論 CPU" << std::endl;
+    }
+
+    // Session 的 intra-op 親和性由 ModelHandle 依模型世代套用 (參見 ThreadPlacement)
+    AffinityScheduler::limitOpenCvThreads(static_cast<int>(placement.pipeline_cpus.size()));
+    // 主執行緒之後建立的執行緒 (OpenCV 執行緒池、指標伺服器) 會繼承這個親和性
+    AffinityScheduler::pinCurrentThread(placement.pipeline_cpus);
+    return placement;
+}
+
+// 若設定了 YOLO_METRICS_FILE，將目前指標以 Prometheus 文字格式寫入該檔案
+static void dumpMetricsIfConfigured() {
+    const char* metrics_file = std::getenv("YOLO_METRICS_FILE");
+    if (metrics_file && *metrics_file) {
+        MetricsRegistry::instance().dumpToFile(metrics_file);
+    }
+}
+
+// 判斷輸入是否為攝影機編號 (例如 "0")
+static bool isCameraIndex(const std::string& source) {
+    if (source.empty()) return false;
+    for (char c : source) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+    }
+    return true;
+}
+
+// 判斷輸入是否為影片檔或串流網址
+static bool isVideoSource(const std::string& source) {
+    if (isCameraIndex(source) || source.find("://") != std::string::npos) {
+        return true;
+    }
+    const std::vector<std::string> video_exts = {".mp4", ".avi", ".mkv", ".mov", ".webm"};
+    for (const auto& ext : video_exts) {
+        if (source.size() > ext.size() &&
+            source.compare(source.size() - ext.size(), ext.size(), ext) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 對單一影格執行完整流程 (LetterBox -> 推論 -> NMS -> 坐標恢復)
+// input_blob 可以是預先配置的 1x3xHxW 緩衝區 (例如 NUMA 本地記憶體)，空的 Mat 則每幀重新配置
+static std::vector<Detection> detectFrame(YOLOv12Inference& yolo_inference, const cv::Mat& frame, cv::Mat& input_blob) {
+    LetterBoxInfo letterbox_info = letterbox(frame, yolo_inference._input_width, yolo_inference._input_height);
+    normalizeAndTranspose(letterbox_info.processed_image, input_blob);
+    std::vector<Detection> raw_detections = yolo_inference.runInference(input_blob);
+    std::vector<Detection> nms_detections = nonMaximumSuppression(raw_detections, NMS_THRESHOLD);
+    return scaleDetections(nms_detections, letterbox_info, frame.cols, frame.rows);
+}
+
+// 啟用執行緒配置時，輸入張量配置在同一 NUMA 節點上並重複使用；
+// 未啟用時 input_blob 維持空的 Mat，由 normalizeAndTranspose 每幀配置
+static void allocateInputBlob(ModelHandle& model_handle, const ThreadPlacement& placement,
+                              std::unique_ptr<NumaBuffer>& input_buffer, cv::Mat& input_blob) {
+    if (placement.node < 0) {
+        return;
+    }
+    std::shared_ptr<YOLOv12Inference> model = model_handle.acquire();
+    int blob_dims[4] = {1, 3, static_cast<int>(model->_input_height), static_cast<int>(model->_input_width)};
+    input_buffer.reset(new NumaBuffer(3 * model->_input_height * model->_input_width * sizeof(float), placement.node));
+    input_blob = cv::Mat(4, blob_dims, CV_32F, input_buffer->data());
+}
+
+// 即時串流模式：擷取執行緒只保留最新影格，推論執行緒依截止時間丟棄過期影格，
+// 持續過載時自動降幀，以固定的延遲上限取代處理每一幀。
+// 串流期間收到 SIGHUP 會在背景重新載入 model_path 並熱切換，不中斷處理
+static int runVideoStream(ModelHandle& model_handle, const std::string& model_path, const std::string& source,
+                          const ThreadPlacement& placement) {
+    cv::VideoCapture capture;
+    bool is_camera = isCameraIndex(source);
+    bool opened = is_camera ? capture.open(std::stoi(source)) : capture.open(source);
+    if (!opened || !capture.isOpened()) {
+        std::cerr << "Error: Could not open video source: " << source << std::endl;
+        return -1;
+    }
+
+    // 影片檔不受擷取速度限制，按原始幀率送出以模擬即時來源
+    double source_fps = capture.get(cv::CAP_PROP_FPS);
+    bool pace_to_fps = !is_camera && source_fps > 0.0;
+
+    RealtimeConfig config = realtimeConfigFromEnv();
+    IngestStats stats;
+    LatestFrameRing ring(config.ring_capacity, stats);
+    RealtimeIngestPolicy policy(config, stats);
+    ScopedMetricCallbacks metric_callbacks;
+    exportIngestMetrics(stats, policy, metric_callbacks);
+    std::atomic<bool> stop_requested(false);
+    std::atomic<bool> capture_done(false);
+
+    std::cout << "Processing video source: " << source
+              << " (幀預算 " << config.frame_budget_ms << " ms, 緩衝區容量 " << config.ring_capacity << ")" << std::endl;
+
+    std::signal(SIGHUP, onReloadSignal);
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+
+    std::unique_ptr<NumaBuffer> input_buffer;
+    cv::Mat input_blob;
+    allocateInputBlob(model_handle, placement, input_buffer, input_blob);
+
+    std::thread capture_thread([&]() {
+        AffinityScheduler::pinCurrentThread(placement.capture_cpus.empty() ? placement.pipeline_cpus
+                                                                          : placement.capture_cpus);
+        uint64_t sequence = 0;
+        SteadyClock::time_point next_frame_time = SteadyClock::now();
+        cv::Mat frame;
+        while (!stop_requested.load() && capture.read(frame)) {
+            SteadyClock::time_point captured_at = SteadyClock::now();
+            stats.captured.fetch_add(1, std::memory_order_relaxed);
+            uint64_t current = sequence++;
+            if (policy.shouldAdmit(current)) {
+                TimedFrame timed_frame;
+                timed_frame.image = std::move(frame); // 交出緩衝區，下一次 read() 會配置新的
+                timed_frame.sequence = current;
+                timed_frame.capture_time = captured_at;
+                policy.stamp(timed_frame);
+                ring.push(std::move(timed_frame));
+            }
+            if (pace_to_fps) {
+                next_frame_time += std::chrono::microseconds(static_cast<int64_t>(1e6 / source_fps));
+                std::this_thread::sleep_until(next_frame_time);
+            }
+        }
+        capture_done.store(true);
+        ring.close();
+    });
+
+    const uint64_t stats_interval = 100; // 每處理 100 幀印出一次計數器
+    TimedFrame timed_frame;
+    while (!stop_requested.load() && !g_stop_requested.load()) {
+        if (g_reload_requested.exchange(false)) {
+            model_handle.reloadAsync(model_path);
+        }
+        if (!ring.pop(timed_frame, std::chrono::milliseconds(100))) {
+            if (capture_done.load() && ring.depth() == 0) break;
+            continue;
+        }
+        if (policy.wouldMissDeadline(timed_frame, SteadyClock::now(), ring.depth() > 0)) {
+            continue; // 來不及在截止時間前完成，且已有較新的影格在等待，直接丟棄
+        }
+
+        Timer frame_timer;
+        std::shared_ptr<YOLOv12Inference> model = model_handle.acquire();
+        std::vector<Detection> final_detections = detectFrame(*model, timed_frame.image, input_blob);
+        policy.recordCompletion(timed_frame, frame_timer.elapsed_ms(), SteadyClock::now());
+
+        drawDetections(timed_frame.image, final_detections);
+        cv::imshow("YOLOv12 Detection Result", timed_frame.image);
+        int key = cv::waitKey(1);
+        if (key == 'q' || key == 27) { // q 或 ESC 結束
+            stop_requested.store(true);
+        }
+
+        if (stats.processed.load() % stats_interval == 0) {
+            printIngestStats(stats, policy, ring.depth());
+            dumpMetricsIfConfigured();
+        }
+    }
+
+    stop_requested.store(true);
+    ring.close();
+    capture_thread.join();
+    printIngestStats(stats, policy, ring.depth());
+    dumpMetricsIfConfigured();
+    return 0;
+}
+
+// 共享記憶體模式：擷取程序以 ShmFrameProducer 寫入原始 BGR 影格，
+// 這裡直接以 cv::Mat 標頭包住共享記憶體做 letterbox，不經過編碼/解碼與複製。
+// 共享環形緩衝區本身就是「最新影格優先」，沿用截止時間與自適應降幀策略。
+// 收到 SIGINT/SIGTERM 時結束；擷取端長時間沒有新影格時檢查它是否重新建立了共享記憶體，是則重新連接。
+// 迴圈在主執行緒 (已綁定到 pipeline CPU) 上執行，輸入張量依 placement 配置在 NUMA 本地記憶體
+static int runShmStream(ModelHandle& model_handle, const std::string& model_path, const std::string& shm_name,
+                        const ThreadPlacement& placement) {
+    std::unique_ptr<ShmFrameConsumer> consumer;
+    try {
+        consumer.reset(new ShmFrameConsumer(shm_name));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    RealtimeConfig config = realtimeConfigFromEnv();
+    IngestStats stats;
+    RealtimeIngestPolicy policy(config, stats);
+    ScopedMetricCallbacks metric_callbacks;
+    exportIngestMetrics(stats, policy, metric_callbacks);
+    std::signal(SIGHUP, onReloadSignal);
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+
+    std::cout << "Processing shared memory source: " << shm_name
+              << " (幀預算 " << config.frame_budget_ms << " ms)" << std::endl;
+
+    std::unique_ptr<NumaBuffer> input_buffer;
+    cv::Mat input_blob;
+    allocateInputBlob(model_handle, placement, input_buffer, input_blob);
+
+    const uint64_t stats_interval = 100; // 每處理 100 幀印出一次計數器
+    const std::chrono::seconds stall_timeout(5); // 超過此時間沒有新影格就檢查擷取端是否重啟
+    uint64_t captured_base = 0;  // 重新連接前累計的影格數 (新的共享記憶體從 0 重新編號)
+    uint64_t skipped_base = 0;
+    uint64_t torn_frames = 0;    // 處理期間 slot 被覆寫而丟棄的影格
+    uint64_t total_detections = 0;
+    SteadyClock::time_point last_progress = SteadyClock::now();
+    bool stall_reported = false;
+    ShmFrameView view;
+    while (!g_stop_requested.load()) {
+        if (g_reload_requested.exchange(false)) {
+            model_handle.reloadAsync(model_path);
+        }
+        if (!consumer->acquireLatest(view)) {
+            SteadyClock::time_point now = SteadyClock::now();
+            if (now - last_progress >= stall_timeout) {
+                last_progress = now; // 每個逾時週期只檢查一次，避免每次輪詢都呼叫 shm_open
+                if (consumer->sourceReplaced()) {
+                    std::cout << "共享記憶體來源已被擷取端重新建立或移除，重新連接: " << shm_name << std::endl;
+                    try {
+                        std::unique_ptr<ShmFrameConsumer> reopened(new ShmFrameConsumer(shm_name));
+                        captured_base = stats.captured.load(std::memory_order_relaxed);
+                        skipped_base += consumer->skippedFrames();
+                        consumer = std::move(reopened);
+                        stall_reported = false;
+                    } catch (const std::exception& e) {
+                        std::cerr << "警告: 重新連接失敗，稍後重試: " << e.what() << std::endl;
+                    }
+                } else if (!stall_reported) {
+                    std::cerr << "警告: 擷取端已 " << stall_timeout.count() << " 秒沒有發布新影格" << std::endl;
+                    stall_reported = true;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(500)); // 等待擷取端發布新影格
+            continue;
+        }
+        last_progress = SteadyClock::now();
+        stall_reported = false;
+        stats.captured.store(captured_base + view.frame_number + 1, std::memory_order_relaxed);
+        stats.overwritten.store(skipped_base + consumer->skippedFrames() + torn_frames, std::memory_order_relaxed);
+
+        // 依影格編號套用降幀間隔 (計入 shed)
+        if (!policy.shouldAdmit(view.frame_number)) {
+            continue;
+        }
+
+        // 擷取時間來自 CLOCK_MONOTONIC，與 steady_clock 同源
+        TimedFrame timed_frame;
+        timed_frame.sequence = view.frame_number;
+        timed_frame.capture_time = SteadyClock::time_point(
+            std::chrono::duration_cast<SteadyClock::duration>(std::chrono::nanoseconds(view.capture_time_ns)));
+        policy.stamp(timed_frame);
+        if (policy.wouldMissDeadline(timed_frame, SteadyClock::now(), consumer->hasNewerFrame(view))) {
+            continue; // 來不及在截止時間前完成，且已有較新的影格，改處理較新的
+        }
+
+        Timer frame_timer;
+        std::shared_ptr<YOLOv12Inference> model = model_handle.acquire();
+        LetterBoxInfo letterbox_info = letterbox(view.image, model->_input_width, model->_input_height);
+        // letterbox 已把像素讀進自己的緩衝區；若期間 slot 被覆寫，結果可能混雜兩幀，直接丟棄
+        if (!consumer->isValid(view)) {
+            ++torn_frames;
+            continue;
+        }
+        normalizeAndTranspose(letterbox_info.processed_image, input_blob);
+        std::vector<Detection> raw_detections = model->runInference(input_blob);
+        std::vector<Detection> nms_detections = nonMaximumSuppression(raw_detections, NMS_THRESHOLD);
+        std::vector<Detection> final_detections = scaleDetections(nms_detections, letterbox_info,
+                                                                   view.image.cols, view.image.rows);
+        policy.recordCompletion(timed_frame, frame_timer.elapsed_ms(), SteadyClock::now());
+        total_detections += final_detections.size();
+
+        if (stats.processed.load() % stats_interval == 0) {
+            // 共享記憶體是唯讀映射，不在影格上繪製；定期印出最近一幀的檢測結果
+            std::cout << "[Shm] frame " << view.frame_number << ": " << final_detections.size()
+                      << " detections (累計 " << total_detections << ")" << std::endl;
+            for (const auto& det : final_detections) {
+                std::cout << "  Class: " << det.class_name
+                          << ", Score: " << det.score
+                          << ", BBox: [x=" << det.bbox.x
+                          << ", y=" << det.bbox.y
+                          << ", w=" << det.bbox.width
+                          << ", h=" << det.bbox.height << "]" << std::endl;
+            }
+            printIngestStats(stats, policy, 0);
+            dumpMetricsIfConfigured();
+        }
+    }
+
+    std::cout << "共享記憶體串流結束，累計 " << total_detections << " 個檢測" << std::endl;
+    printIngestStats(stats, policy, 0);
+    dumpMetricsIfConfigured();
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <path_to_onnx_model> <path_to_image> [path_to_class_names.names]" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <path_to_onnx_model> <path_to_image|path_to_video|camera_index|shm:/name> [path_to_class_names.names]" << std::endl;
         return -1;
     }
 
@@ -36,6 +423,9 @@ int main(int argc, char* argv[]) {
     // ========================================================================
     Ort::SessionOptions session_options;
     session_options.SetGraphOptimizationLevel(ORT_ENABLE_BASIC); // 設置圖優化級別
+
+    // 依 CPU 拓撲綁定執行緒 (YOLO_PIN_THREADS=1)
+    ThreadPlacement placement = planThreadPlacement();
     
     // 嘗試啟用 CUDA 執行提供者 (如果你的 ONNX Runtime 支持 GPU 並且你有 CUDA 環境)
     try {
@@ -46,8 +436,60 @@ int main(int argc, char* argv[]) {
     }
     // ========================================================================
 
+    // 只關心部分類別時，以 YOLO_CLASSES 指定類別與個別閾值，例如 "person:0.4,car,truck:0.3"
+    ClassFilter class_filter;
+    const char* classes_spec = std::getenv("YOLO_CLASSES");
+    if (classes_spec && *classes_spec) {
+        class_filter = ClassFilter::parse(classes_spec, class_names);
+        if (class_filter.enabled_classes.empty()) {
+            std::cerr << "警告: YOLO_CLASSES 沒有任何有效類別，將解碼全部類別。" << std::endl;
+        }
+    }
+
     // 2. 初始化 YOLOv12 推論引擎，現在傳遞 conf_threshold 參數
-    YOLOv12Inference yolo_inference(model_path, class_names, session_options, CONF_THRESHOLD);
+    // 透過 ModelHandle 載入並預熱，之後可在不中斷推論的情況下熱切換模型
+    ModelHandle model_handle(model_path, class_names, session_options, CONF_THRESHOLD, class_filter,
+                             1, placement.inferenceCpuSets());
+    if (placement.node >= 0) {
+        model_handle.bindOutputsToNode(placement.node);
+    }
+
+    // 設定 YOLO_METRICS_PORT 時在 127.0.0.1 提供 Prometheus /metrics
+    std::unique_ptr<MetricsHttpServer> metrics_server;
+    const char* metrics_port = std::getenv("YOLO_METRICS_PORT");
+    if (metrics_port && *metrics_port) {
+        int port = 0;
+        try {
+            size_t parsed_chars = 0;
+            port = std::stoi(metrics_port, &parsed_chars);
+            if (parsed_chars != std::strlen(metrics_port)) port = 0;
+        } catch (const std::exception&) {
+            port = 0;
+        }
+        if (port < 1 || port > 65535) {
+            std::cerr << "警告: 無效的 YOLO_METRICS_PORT '" << metrics_port << "' (需為 1-65535)，不提供 /metrics" << std::endl;
+        } else {
+            metrics_server.reset(new MetricsHttpServer(port));
+            if (!metrics_server->start()) {
+                std::cerr << "警告: 無法在埠 " << port << " 啟動指標服務，不提供 /metrics" << std::endl;
+                metrics_server.reset();
+            }
+        }
+    }
+
+    // 共享記憶體來源 (例如 "shm:/yolo_frames")，由另一個擷取程序寫入
+    const std::string shm_prefix = "shm:";
+    if (image_path.compare(0, shm_prefix.size(), shm_prefix) == 0) {
+        return runShmStream(model_handle, model_path, image_path.substr(shm_prefix.size()), placement);
+    }
+
+    // 影片檔、串流網址或攝影機編號走即時串流流程，每幀各自從 model_handle 取得模型
+    if (isVideoSource(image_path)) {
+        return runVideoStream(model_handle, model_path, image_path, placement);
+    }
+
+    std::shared_ptr<YOLOv12Inference> model = model_handle.acquire();
+    YOLOv12Inference& yolo_inference = *model;
 
     // 3. 讀取圖像
     cv::Mat original_image = cv::imread(image_path);
@@ -164,6 +606,7 @@ int main(int argc, char* argv[]) {
     std::string output_filename = "output/output_detection_result.jpg";
     cv::imwrite(output_filename, drawn_image);
     std::cout << "Detection result saved to " << output_filename << std::endl;
+    dumpMetricsIfConfigured();
 
     // 9. 顯示結果 (已註銷)
     cv::imshow("YOLOv12 Detection Result", drawn_image);
@@ -0,0 +1,356 @@
+// src/metrics/metrics.cpp
+#include "metrics.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+// 延遲直方圖的桶邊界 (秒)：0.1 ms 到 1 s
+const std::vector<double> kLatencyBucketsSeconds = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                                                    0.025, 0.05, 0.1, 0.25, 0.5, 1};
+// 以秒記錄的延遲總和保留到奈秒
+const int kLatencySumDecimals = 9;
+// 每幀檢測數的桶邊界
+const std::vector<double> kDetectionBuckets = {0, 1, 2, 5, 10, 20, 50, 100, 300};
+
+// 將 labels 與額外標籤組成 {a="b",le="c"}
+std::string joinLabels(const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) return "";
+    if (labels.empty()) return "{" + extra + "}";
+    if (extra.empty()) return "{" + labels + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+std::string formatBound(double bound) {
+    std::ostringstream oss;
+    oss << bound;
+    return oss.str();
+}
+
+// 回呼指標的值：整數 (計數器) 以整數輸出，其餘保留 double 的完整精度。
+// 預設的 6 位有效數字會讓 1234567 變成 1.23457e+06，rate() 隨之失真
+std::string formatValue(double value) {
+    std::ostringstream oss;
+    if (std::isfinite(value) && value == std::floor(value) && std::fabs(value) < 9007199254740992.0) { // 2^53
+        oss << static_cast<int64_t>(value);
+    } else {
+        oss << std::setprecision(17) << value;
+    }
+    return oss.str();
+}
+
+// 直方圖總和以 10^-decimals 為單位累加，輸出為精確的 decimals 位小數
+std::string formatFixed(uint64_t units, int decimals, uint64_t scale) {
+    if (decimals == 0) {
+        return std::to_string(units);
+    }
+    char buffer[48];
+    std::snprintf(buffer, sizeof(buffer), "%" PRIu64 ".%0*" PRIu64, units / scale, decimals, units % scale);
+    return buffer;
+}
+
+// 客戶端連線後未送出請求或不讀取回應時，最多等待這麼久，避免卡住服務執行緒與 stop()
+const int kClientTimeoutMs = 1000;
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Histogram
+// ---------------------------------------------------------------------------
+
+Histogram::Histogram(const std::vector<double>& upper_bounds, int sum_decimals)
+    : _upper_bounds(upper_bounds)
+    , _buckets(new std::atomic<uint64_t>[upper_bounds.size() + 1])
+    , _sum_decimals(std::min(std::max(sum_decimals, 0), 12))
+    , _sum_scale(1)
+{
+    for (int i = 0; i < _sum_decimals; ++i) {
+        _sum_scale *= 10;
+    }
+    std::sort(_upper_bounds.begin(), _upper_bounds.end());
+    for (size_t i = 0; i <= _upper_bounds.size(); ++i) {
+        _buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observe(double value) {
+    // 桶數很少 (約十個)，線性搜尋比二分搜尋更快且分支可預測
+    size_t i = 0;
+    while (i < _upper_bounds.size() && value > _upper_bounds[i]) {
+        ++i;
+    }
+    _buckets[i].fetch_add(1, std::memory_order_relaxed);
+    _sum_units.fetch_add(static_cast<uint64_t>(std::max(value, 0.0) * static_cast<double>(_sum_scale) + 0.5),
+                         std::memory_order_relaxed);
+}
+
+uint64_t Histogram::count() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i <= _upper_bounds.size(); ++i) {
+        total += bucketCount(i);
+    }
+    return total;
+}
+
+// ---------------------------------------------------------------------------
+// MetricsRegistry
+// ---------------------------------------------------------------------------
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, const std::string& help,
+                                                 const std::string& type) {
+    Family& f = _families[name];
+    if (f.type.empty()) {
+        f.help = help;
+        f.type = type;
+    }
+    return f;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<Counter>& slot = family(name, help, "counter").counters[labels];
+    if (!slot) slot.reset(new Counter());
+    return *slot;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<Gauge>& slot = family(name, help, "gauge").gauges[labels];
+    if (!slot) slot.reset(new Gauge());
+    return *slot;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      const std::vector<double>& upper_bounds, const std::string& labels,
+                                      int sum_decimals) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<Histogram>& slot = family(name, help, "histogram").histograms[labels];
+    if (!slot) slot.reset(new Histogram(upper_bounds, sum_decimals));
+    return *slot;
+}
+
+uint64_t MetricsRegistry::addCallback(const std::string& name, const std::string& help, const std::string& type,
+                                      const std::string& labels, std::function<double()> read) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t id = _next_callback_id++;
+    family(name, help, type).callbacks[id] = std::make_pair(labels, std::move(read));
+    return id;
+}
+
+void MetricsRegistry::removeCallback(uint64_t id) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& entry : _families) {
+        if (entry.second.callbacks.erase(id) > 0) {
+            return;
+        }
+    }
+}
+
+std::string MetricsRegistry::renderPrometheus() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::ostringstream out;
+    for (const auto& entry : _families) {
+        const std::string& name = entry.first;
+        const Family& f = entry.second;
+        if (f.counters.empty() && f.gauges.empty() && f.histograms.empty() && f.callbacks.empty()) {
+            continue;
+        }
+        out << "# HELP " << name << " " << f.help << "\n";
+        out << "# TYPE " << name << " " << f.type << "\n";
+        for (const auto& c : f.counters) {
+            out << name << joinLabels(c.first) << " " << c.second->value() << "\n";
+        }
+        for (const auto& g : f.gauges) {
+            out << name << joinLabels(g.first) << " " << g.second->value() << "\n";
+        }
+        for (const auto& cb : f.callbacks) {
+            out << name << joinLabels(cb.second.first) << " " << formatValue(cb.second.second()) << "\n";
+        }
+        for (const auto& h : f.histograms) {
+            const Histogram& hist = *h.second;
+            const std::vector<double>& bounds = hist.upperBounds();
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < bounds.size(); ++i) {
+                cumulative += hist.bucketCount(i);
+                out << name << "_bucket" << joinLabels(h.first, "le=\"" + formatBound(bounds[i]) + "\"")
+                    << " " << cumulative << "\n";
+            }
+            cumulative += hist.bucketCount(bounds.size());
+            out << name << "_bucket" << joinLabels(h.first, "le=\"+Inf\"") << " " << cumulative << "\n";
+            uint64_t scale = 1;
+            for (int i = 0; i < hist.sumDecimals(); ++i) scale *= 10;
+            out << name << "_sum" << joinLabels(h.first) << " "
+                << formatFixed(hist.sumUnits(), hist.sumDecimals(), scale) << "\n";
+            out << name << "_count" << joinLabels(h.first) << " " << cumulative << "\n";
+        }
+    }
+    return out.str();
+}
+
+bool MetricsRegistry::dumpToFile(const std::string& path) const {
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream ofs(tmp_path);
+        if (!ofs.is_open()) {
+            std::cerr << "Error: Could not open metrics file: " << tmp_path << std::endl;
+            return false;
+        }
+        ofs << renderPrometheus();
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+// ---------------------------------------------------------------------------
+// ScopedMetricCallbacks
+// ---------------------------------------------------------------------------
+
+ScopedMetricCallbacks::~ScopedMetricCallbacks() {
+    for (uint64_t id : _ids) {
+        MetricsRegistry::instance().removeCallback(id);
+    }
+}
+
+void ScopedMetricCallbacks::add(const std::string& name, const std::string& help, const std::string& type,
+                                const std::string& labels, std::function<double()> read) {
+    _ids.push_back(MetricsRegistry::instance().addCallback(name, help, type, labels, std::move(read)));
+}
+
+// ---------------------------------------------------------------------------
+// PipelineMetrics
+// ---------------------------------------------------------------------------
+
+PipelineMetrics& pipelineMetrics() {
+    static PipelineMetrics metrics = []() {
+        MetricsRegistry& r = MetricsRegistry::instance();
+        const std::string latency_name = "yolo_stage_latency_seconds";
+        const std::string latency_help = "Per-stage latency in seconds.";
+        auto stage = [&](const char* label) -> Histogram& {
+            return r.histogram(latency_name, latency_help, kLatencyBucketsSeconds,
+                               std::string("stage=\"") + label + "\"", kLatencySumDecimals);
+        };
+        return PipelineMetrics{
+            stage("letterbox"),
+            stage("normalize"),
+            stage("inference"),
+            stage("decode"),
+            stage("nms"),
+            stage("scale"),
+            stage("draw"),
+            r.histogram("yolo_detections_per_frame", "Detections kept after NMS per frame.", kDetectionBuckets),
+            r.counter("yolo_frames_total", "Frames passed through session.Run."),
+            r.counter("yolo_inference_failures_total", "session.Run calls that threw."),
+            r.counter("yolo_model_swaps_total", "Successful model hot swaps."),
+            r.counter("yolo_model_swap_failures_total", "Rejected or failed model hot swaps."),
+        };
+    }();
+    return metrics;
+}
+
+// ---------------------------------------------------------------------------
+// MetricsHttpServer
+// ---------------------------------------------------------------------------
+
+MetricsHttpServer::MetricsHttpServer(int port)
+    : _port(port)
+    , _listen_fd(-1)
+    , _running(false)
+{
+}
+
+MetricsHttpServer::~MetricsHttpServer() {
+    stop();
+}
+
+bool MetricsHttpServer::start() {
+    if (_port < 1 || _port > 65535) {
+        std::cerr << "Error: invalid metrics server port: " << _port << std::endl;
+        return false;
+    }
+    _listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listen_fd < 0) {
+        std::cerr << "Error: metrics server socket() failed." << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(_port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(_listen_fd, 8) != 0) {
+        std::cerr << "Error: metrics server could not listen on 127.0.0.1:" << _port << std::endl;
+        close(_listen_fd);
+        _listen_fd = -1;
+        return false;
+    }
+
+    _running.store(true);
+    _thread = std::thread(&MetricsHttpServer::serve, this);
+    std::cout << "Metrics available at http://127.0.0.1:" << _port << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsHttpServer::stop() {
+    if (!_running.exchange(false)) {
+        return;
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    close(_listen_fd);
+    _listen_fd = -1;
+}
+
+void MetricsHttpServer::serve() {
+    while (_running.load()) {
+        // 以 poll 逾時定期檢查 _running，stop() 不需要中斷 accept
+        pollfd pfd{_listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        int client_fd = accept(_listen_fd, nullptr, nullptr);
+        if (client_fd < 0) {
+            continue;
+        }
+        // 收送都設定逾時：連線後不送請求或不讀回應的客戶端不會讓服務執行緒無限期阻塞
+        timeval timeout{kClientTimeoutMs / 1000, (kClientTimeoutMs % 1000) * 1000};
+        setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        // 不解析請求內容，任何路徑都回傳指標
+        char request[2048];
+        ssize_t ignored = recv(client_fd, request, sizeof(request), 0);
+        (void)ignored;
+
+        std::string body = MetricsRegistry::instance().renderPrometheus();
+        std::string response = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t n = send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        close(client_fd);
+    }
+}
@@ -0,0 +1,176 @@
+// src/metrics/metrics.h
+#ifndef YOLO_METRICS_H
+#define YOLO_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 單調遞增計數器；熱路徑上只有一次 relaxed fetch_add
+class Counter {
+public:
+    void inc(uint64_t n = 1) { _value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> _value{0};
+};
+
+// 可增可減的量測值 (例如佇列深度)
+class Gauge {
+public:
+    void set(int64_t v) { _value.store(v, std::memory_order_relaxed); }
+    void add(int64_t n) { _value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> _value{0};
+};
+
+// 固定邊界的直方圖；observe() 只做線性搜尋與兩次 relaxed fetch_add，不需要鎖。
+// 總和以 10^-sum_decimals 為單位的整數累加並以該位數精確輸出；
+// 以秒記錄的延遲使用 9 位 (奈秒)，次微秒的觀測值才不會被截斷
+class Histogram {
+public:
+    explicit Histogram(const std::vector<double>& upper_bounds, int sum_decimals = 6);
+
+    void observe(double value);
+
+    const std::vector<double>& upperBounds() const { return _upper_bounds; }
+    uint64_t bucketCount(size_t i) const { return _buckets[i].load(std::memory_order_relaxed); } // 非累積
+    uint64_t count() const;
+    double sum() const { return static_cast<double>(sumUnits()) / static_cast<double>(_sum_scale); }
+    uint64_t sumUnits() const { return _sum_units.load(std::memory_order_relaxed); } // 以 10^-sumDecimals() 為單位
+    int sumDecimals() const { return _sum_decimals; }
+
+private:
+    std::vector<double> _upper_bounds;                // 遞增排列，最後一個隱含為 +Inf
+    std::unique_ptr<std::atomic<uint64_t>[]> _buckets; // _upper_bounds.size() + 1 個 (含 +Inf)
+    int _sum_decimals;
+    uint64_t _sum_scale;                              // 10^_sum_decimals
+    std::atomic<uint64_t> _sum_units{0};              // 以整數單位累加，避免浮點 CAS
+};
+
+// 以建構/解構時間量測一段程式碼並寫入直方圖 (秒，Prometheus 的基本單位)；histogram 為 nullptr 時不記錄
+class ScopedLatency {
+public:
+    explicit ScopedLatency(Histogram& histogram) : ScopedLatency(&histogram) {}
+    explicit ScopedLatency(Histogram* histogram)
+        : _histogram(histogram), _start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        if (!_histogram) {
+            return;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - _start;
+        _histogram->observe(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1e9);
+    }
+
+private:
+    Histogram* _histogram;
+    std::chrono::steady_clock::time_point _start;
+};
+
+// 全域指標登錄表：註冊時加鎖，回傳的參考在程序結束前有效，熱路徑直接操作參考
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // labels 為 Prometheus 標籤字串，例如 stage="nms"；同名同標籤重複註冊回傳同一個實例
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         const std::vector<double>& upper_bounds, const std::string& labels = "",
+                         int sum_decimals = 6);
+
+    // 於輸出時才取值的指標，適合包裝既有的計數器；回傳的 id 用於 removeCallback()
+    uint64_t addCallback(const std::string& name, const std::string& help, const std::string& type,
+                         const std::string& labels, std::function<double()> read);
+    void removeCallback(uint64_t id);
+
+    // 以 Prometheus 文字格式 (0.0.4) 輸出所有指標
+    std::string renderPrometheus() const;
+
+    // 寫入檔案 (先寫暫存檔再改名，讀取端不會看到一半的內容)
+    bool dumpToFile(const std::string& path) const;
+
+private:
+    MetricsRegistry() = default;
+
+    struct Family {
+        std::string help;
+        std::string type;
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+        std::map<uint64_t, std::pair<std::string, std::function<double()>>> callbacks; // id -> (labels, read)
+    };
+
+    Family& family(const std::string& name, const std::string& help, const std::string& type);
+
+    mutable std::mutex _mutex;
+    std::map<std::string, Family> _families;
+    uint64_t _next_callback_id = 1;
+};
+
+// 回呼指標的 RAII 包裝：離開作用域時移除，避免回呼引用已銷毀的物件
+class ScopedMetricCallbacks {
+public:
+    ScopedMetricCallbacks() = default;
+    ~ScopedMetricCallbacks();
+    ScopedMetricCallbacks(const ScopedMetricCallbacks&) = delete;
+    ScopedMetricCallbacks& operator=(const ScopedMetricCallbacks&) = delete;
+
+    void add(const std::string& name, const std::string& help, const std::string& type,
+             const std::string& labels, std::function<double()> read);
+
+private:
+    std::vector<uint64_t> _ids;
+};
+
+// 推論流程各階段的預先註冊指標；延遲直方圖以秒記錄 (yolo_stage_latency_seconds)
+struct PipelineMetrics {
+    Histogram& letterbox_seconds; // 前處理：letterbox
+    Histogram& normalize_seconds; // 前處理：正規化與 HWC -> CHW
+    Histogram& inference_seconds; // session.Run
+    Histogram& decode_seconds;    // 輸出張量解碼
+    Histogram& nms_seconds;
+    Histogram& scale_seconds;
+    Histogram& draw_seconds;
+    Histogram& detections_per_frame;
+    Counter& frames;
+    Counter& inference_failures;
+    Counter& model_swaps;
+    Counter& model_swap_failures;
+};
+
+// 取得 (第一次呼叫時註冊) 推論流程指標
+PipelineMetrics& pipelineMetrics();
+
+// 在本機 HTTP 埠提供 /metrics；只綁定 127.0.0.1
+class MetricsHttpServer {
+public:
+    explicit MetricsHttpServer(int port);
+    ~MetricsHttpServer();
+    MetricsHttpServer(const MetricsHttpServer&) = delete;
+    MetricsHttpServer& operator=(const MetricsHttpServer&) = delete;
+
+    bool start(); // 埠號不在 1-65535 或綁定失敗時回傳 false
+    void stop();
+
+private:
+    void serve();
+
+    int _port;
+    int _listen_fd;
+    std::atomic<bool> _running;
+    std::thread _thread;
+};
+
+#endif // YOLO_METRICS_H
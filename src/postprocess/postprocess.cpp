@@ -1,9 +1,13 @@
 #include "postprocess.h"
 #include <algorithm> // For std::sort, std::max, std::min
+#include "../metrics/metrics.h"
 
 // 實現非極大值抑制 (NMS)
 std::vector<Detection> nonMaximumSuppression(std::vector<Detection>& detections, float nms_threshold) {
+    PipelineMetrics& metrics = pipelineMetrics();
+    ScopedLatency latency(metrics.nms_seconds);
     if (detections.empty()) {
+        metrics.detections_per_frame.observe(0);
         return {};
     }
 
@@ -39,6 +43,7 @@ std::vector<Detection> nonMaximumSuppression(std::vector<Detection>& detections,
             }
         }
     }
+    metrics.detections_per_frame.observe(static_cast<double>(result.size()));
     return result;
 }
 
@@ -47,6 +52,7 @@ std::vector<Detection> scaleDetections(const std::vector<Detection>& detections,
                                        const LetterBoxInfo& letterbox_info,
                                        int original_img_width,
                                        int original_img_height) {
+    ScopedLatency latency(pipelineMetrics().scale_seconds);
     std::vector<Detection> scaled_detections;
     for (const auto& det : detections) {
         Detection scaled_det = det;
@@ -96,6 +102,7 @@ std::vector<Detection> scaleDetections(const std::vector<Detection>& detections,
 
 // 在圖像上繪製檢測結果
 void drawDetections(cv::Mat& image, const std::vector<Detection>& detections) {
+    ScopedLatency latency(pipelineMetrics().draw_seconds);
     for (const auto& det : detections) {
         // 繪製邊界框
         cv::rectangle(image, det.bbox, cv::Scalar(0, 255, 0), 2); // 綠色框
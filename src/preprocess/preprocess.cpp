@@ -1,8 +1,10 @@
 #include "preprocess.h"
 #include <iostream>
+#include "../metrics/metrics.h"
 
 // 實現 LetterBox 圖像調整
 LetterBoxInfo letterbox(const cv::Mat& image, int target_width, int target_height) {
+    ScopedLatency latency(pipelineMetrics().letterbox_seconds);
     LetterBoxInfo info;
     info.processed_image = cv::Mat(); // 初始化為空
 
@@ -47,6 +49,13 @@ LetterBoxInfo letterbox(const cv::Mat& image, int target_width, int target_heigh
 // 實現圖像數據正規化和通道轉置 (HWC -> CHW)
 // 假定模型輸入是 float32，範圍 0-1
 cv::Mat normalizeAndTranspose(const cv::Mat& image) {
+    cv::Mat blob;
+    normalizeAndTranspose(image, blob);
+    return blob;
+}
+
+void normalizeAndTranspose(const cv::Mat& image, cv::Mat& blob) {
+    ScopedLatency latency(pipelineMetrics().normalize_seconds);
     cv::Mat float_image;
     // 將圖像數據類型轉換為 float32
     image.convertTo(float_image, CV_32FC3, 1.0 / 255.0); // 歸一化到 0-1 範圍
@@ -69,7 +78,6 @@ cv::Mat normalizeAndTranspose(const cv::Mat& image) {
     cv::Mat rgb_image;
     cv::cvtColor(float_image, rgb_image, cv::COLOR_BGR2RGB); // 通常需要 BGR2RGB
 
-    cv::Mat blob;
     // blobFromImage 預設會進行 1/255.0 縮放，這裡我們已手動進行，所以 scale_factor 設為 1.0
     // dnn::blobFromImage 的輸出是 NCHW (batch, channel, height, width) 格式
     // 這裡我們只處理單張圖片，所以 batch=1
@@ -92,6 +100,4 @@ cv::Mat normalizeAndTranspose(const cv::Mat& image) {
                   << ", C=" << blob.size[1] << ", H=" << blob.size[2] << ", W=" << blob.size[3] << std::endl;
     }
     // ====================================================================
-
-    return blob;
 }
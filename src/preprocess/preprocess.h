@@ -20,4 +20,7 @@ LetterBoxInfo letterbox(const cv::Mat& image, int target_width, int target_heigh
 // 函數宣告：執行圖像數據正規化和通道轉置 (HWC -> CHW)
 // 這個函數將圖像像素值歸一化到 0-1 範圍，並將圖像從 HWC 格式轉換為 NCHW (對於單張圖片 N=1)
 cv::Mat normalizeAndTranspose(const cv::Mat& image);
+
+// 同上，但寫入呼叫者提供的 blob；blob 已是 1x3xHxW CV_32F 時直接覆寫其資料 (例如 NUMA 本地緩衝區)
+void normalizeAndTranspose(const cv::Mat& image, cv::Mat& blob);
 #endif // PREPROCESS_H
\ No newline at end of file
@@ -0,0 +1,202 @@
+// src/realtime/realtime_ingest.cpp
+#include "realtime_ingest.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// 處理時間指數移動平均的權重
+const double kProcessingEmaAlpha = 0.2;
+
+double toMs(SteadyClock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+}
+
+} // namespace
+
+RealtimeConfig realtimeConfigFromEnv() {
+    RealtimeConfig config;
+    const char* budget = std::getenv("YOLO_FRAME_BUDGET_MS");
+    if (budget && *budget) {
+        try {
+            double budget_ms = std::stod(budget);
+            if (budget_ms <= 0.0) {
+                throw std::invalid_argument("non-positive");
+            }
+            config.frame_budget_ms = budget_ms;
+        } catch (const std::exception&) {
+            std::cerr << "警告: 無效的 YOLO_FRAME_BUDGET_MS '" << budget << "'，使用預設值 "
+                      << config.frame_budget_ms << " ms" << std::endl;
+        }
+    }
+    return config;
+}
+
+// ---------------------------------------------------------------------------
+// LatestFrameRing
+// ---------------------------------------------------------------------------
+
+LatestFrameRing::LatestFrameRing(size_t capacity, IngestStats& stats)
+    : _capacity(std::max<size_t>(capacity, 1))
+    , _stats(stats)
+    , _depth_gauge(MetricsRegistry::instance().gauge("yolo_queue_depth", "Frames waiting in a pipeline queue.",
+                                                    "queue=\"frame_ring\""))
+    , _closed(false)
+{
+}
+
+void LatestFrameRing::push(TimedFrame frame) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_closed) {
+            return;
+        }
+        // 緩衝區已滿：丟棄最舊的影格，保證等待中的影格不超過容量
+        while (_frames.size() >= _capacity) {
+            _frames.pop_front();
+            _stats.overwritten.fetch_add(1, std::memory_order_relaxed);
+        }
+        _frames.push_back(std::move(frame));
+        _depth_gauge.set(static_cast<int64_t>(_frames.size()));
+    }
+    _cv.notify_one();
+}
+
+bool LatestFrameRing::pop(TimedFrame& out, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_cv.wait_for(lock, timeout, [this]() { return !_frames.empty() || _closed; })) {
+        return false; // 逾時
+    }
+    if (_frames.empty()) {
+        return false; // 已關閉且沒有剩餘影格
+    }
+    out = std::move(_frames.front());
+    _frames.pop_front();
+    _depth_gauge.set(static_cast<int64_t>(_frames.size()));
+    return true;
+}
+
+void LatestFrameRing::close() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+    }
+    _cv.notify_all();
+}
+
+size_t LatestFrameRing::depth() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _frames.size();
+}
+
+// ---------------------------------------------------------------------------
+// RealtimeIngestPolicy
+// ---------------------------------------------------------------------------
+
+RealtimeIngestPolicy::RealtimeIngestPolicy(const RealtimeConfig& config, IngestStats& stats)
+    : _config(config)
+    , _stats(stats)
+    , _stride(1)
+    , _expected_processing_ms(0.0)
+    , _overloaded_streak(0)
+    , _idle_streak(0)
+{
+}
+
+void RealtimeIngestPolicy::stamp(TimedFrame& frame) const {
+    frame.deadline = frame.capture_time +
+        std::chrono::microseconds(static_cast<int64_t>(_config.frame_budget_ms * 1000.0));
+}
+
+bool RealtimeIngestPolicy::shouldAdmit(uint64_t sequence) {
+    int stride = _stride.load(std::memory_order_relaxed);
+    if (stride > 1 && sequence % stride != 0) {
+        _stats.shed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool RealtimeIngestPolicy::wouldMissDeadline(const TimedFrame& frame, SteadyClock::time_point now,
+                                             bool newer_frame_waiting) {
+    if (!newer_frame_waiting) {
+        return false; // 這已是最新影格：照常處理，完成時計入 deadline_missed 並驅動降幀
+    }
+    double remaining_ms = toMs(frame.deadline - now);
+    if (remaining_ms < _expected_processing_ms.load(std::memory_order_relaxed)) {
+        _stats.late.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void RealtimeIngestPolicy::recordCompletion(const TimedFrame& frame, double processing_ms,
+                                            SteadyClock::time_point finished) {
+    _stats.processed.fetch_add(1, std::memory_order_relaxed);
+    if (finished > frame.deadline) {
+        _stats.deadline_missed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 更新處理時間預估；第一幀直接採用量測值
+    double expected = _expected_processing_ms.load(std::memory_order_relaxed);
+    expected = (expected <= 0.0) ? processing_ms
+                                 : expected + kProcessingEmaAlpha * (processing_ms - expected);
+    _expected_processing_ms.store(expected, std::memory_order_relaxed);
+
+    // 以端到端延遲判斷過載：持續超出預算就倍增降幀間隔，持續空閒則逐步恢復
+    double latency_ms = toMs(finished - frame.capture_time);
+    if (latency_ms > _config.frame_budget_ms) {
+        ++_overloaded_streak;
+        _idle_streak = 0;
+    } else if (latency_ms < _config.frame_budget_ms * _config.recover_ratio) {
+        ++_idle_streak;
+        _overloaded_streak = 0;
+    } else {
+        _overloaded_streak = 0;
+        _idle_streak = 0;
+    }
+
+    int stride = _stride.load(std::memory_order_relaxed);
+    if (_overloaded_streak >= _config.adapt_window && stride < _config.max_stride) {
+        stride = std::min(stride * 2, _config.max_stride);
+        _stride.store(stride, std::memory_order_relaxed);
+        _overloaded_streak = 0;
+        std::cout << "持續過載，降幀間隔調整為每 " << stride << " 幀處理 1 幀" << std::endl;
+    } else if (_idle_streak >= _config.adapt_window && stride > 1) {
+        stride -= 1;
+        _stride.store(stride, std::memory_order_relaxed);
+        _idle_streak = 0;
+        std::cout << "負載下降，降幀間隔調整為每 " << stride << " 幀處理 1 幀" << std::endl;
+    }
+}
+
+void printIngestStats(const IngestStats& stats, const RealtimeIngestPolicy& policy, size_t queue_depth) {
+    std::cout << "[Realtime] captured=" << stats.captured.load()
+              << " processed=" << stats.processed.load()
+              << " shed=" << stats.shed.load()
+              << " overwritten=" << stats.overwritten.load()
+              << " late=" << stats.late.load()
+              << " deadline_missed=" << stats.deadline_missed.load()
+              << " stride=" << policy.stride()
+              << " expected_ms=" << policy.expectedProcessingMs()
+              << " queue=" << queue_depth << std::endl;
+}
+
+void exportIngestMetrics(const IngestStats& stats, const RealtimeIngestPolicy& policy,
+                         ScopedMetricCallbacks& callbacks) {
+    const std::string name = "yolo_stream_frames_total";
+    const std::string help = "Real-time stream frames by outcome.";
+    callbacks.add(name, help, "counter", "outcome=\"captured\"", [&stats]() { return static_cast<double>(stats.captured.load()); });
+    callbacks.add(name, help, "counter", "outcome=\"shed\"", [&stats]() { return static_cast<double>(stats.shed.load()); });
+    callbacks.add(name, help, "counter", "outcome=\"overwritten\"", [&stats]() { return static_cast<double>(stats.overwritten.load()); });
+    callbacks.add(name, help, "counter", "outcome=\"late\"", [&stats]() { return static_cast<double>(stats.late.load()); });
+    callbacks.add(name, help, "counter", "outcome=\"deadline_missed\"", [&stats]() { return static_cast<double>(stats.deadline_missed.load()); });
+    callbacks.add(name, help, "counter", "outcome=\"processed\"", [&stats]() { return static_cast<double>(stats.processed.load()); });
+    callbacks.add("yolo_stream_stride", "Current adaptive frame stride (process 1 of N).", "gauge", "",
+                  [&policy]() { return static_cast<double>(policy.stride()); });
+    callbacks.add("yolo_stream_expected_processing_seconds", "EMA of per-frame processing time in seconds.", "gauge", "",
+                  [&policy]() { return policy.expectedProcessingMs() / 1000.0; });
+}
@@ -0,0 +1,113 @@
+// src/realtime/realtime_ingest.h
+#ifndef YOLO_REALTIME_INGEST_H
+#define YOLO_REALTIME_INGEST_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "../metrics/metrics.h"
+
+using SteadyClock = std::chrono::steady_clock;
+
+// 一個帶有時間戳與截止時間的影格
+struct TimedFrame {
+    cv::Mat image;                    // 原始 BGR 影格
+    uint64_t sequence = 0;            // 擷取序號 (從 0 開始)
+    SteadyClock::time_point capture_time;
+    SteadyClock::time_point deadline; // 超過此時間才完成的結果視為過期
+};
+
+// 即時串流的丟幀/處理計數器，擷取執行緒與推論執行緒都會更新
+struct IngestStats {
+    std::atomic<uint64_t> captured{0};       // 從來源讀到的影格
+    std::atomic<uint64_t> shed{0};           // 因自適應降幀而未進入緩衝區的影格
+    std::atomic<uint64_t> overwritten{0};    // 在緩衝區中被較新影格覆蓋的影格
+    std::atomic<uint64_t> late{0};           // 預估無法在截止時間前完成而在推論前丟棄的影格
+    std::atomic<uint64_t> deadline_missed{0};// 已處理但完成時間超過截止時間的影格
+    std::atomic<uint64_t> processed{0};      // 完成推論的影格
+};
+
+// 即時攝取策略設定
+struct RealtimeConfig {
+    size_t ring_capacity = 1;         // 緩衝區容量；1 即「最新影格優先」的單槽模式
+    double frame_budget_ms = 100.0;   // 從擷取到完成的延遲上限，用於計算每幀截止時間
+    int max_stride = 8;               // 自適應降幀的最大間隔 (每 N 幀處理 1 幀)
+    int adapt_window = 30;            // 連續多少幀過載/空閒才調整一次間隔
+    double recover_ratio = 0.5;       // 延遲低於預算的此比例視為空閒，可降低間隔
+};
+
+// 以預設值為基礎，套用環境變數 YOLO_FRAME_BUDGET_MS (每幀延遲上限，毫秒)；無效值印出警告並沿用預設
+RealtimeConfig realtimeConfigFromEnv();
+
+// 固定容量的影格環形緩衝區：滿時新影格覆蓋最舊的影格，
+// 讓延遲不隨推論落後而無限增長
+class LatestFrameRing {
+public:
+    LatestFrameRing(size_t capacity, IngestStats& stats);
+
+    // 放入影格；緩衝區已滿時丟棄最舊的一幀
+    void push(TimedFrame frame);
+
+    // 取出最舊的一幀；在 timeout 內沒有影格或緩衝區已關閉且為空時回傳 false
+    bool pop(TimedFrame& out, std::chrono::milliseconds timeout);
+
+    // 關閉緩衝區，喚醒等待中的 pop()
+    void close();
+
+    size_t depth() const;
+
+private:
+    size_t _capacity;
+    IngestStats& _stats;
+    Gauge& _depth_gauge; // yolo_queue_depth{queue="frame_ring"}
+    std::deque<TimedFrame> _frames;
+    bool _closed;
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+};
+
+// 截止時間與自適應降幀策略
+// 擷取端呼叫 shouldAdmit() 決定是否放行，推論端在處理前呼叫 wouldMissDeadline()，
+// 處理完後呼叫 recordCompletion() 回報延遲，策略據此調整降幀間隔。
+// 只有在有更新的影格可以取代時才丟棄過期影格；持續過載由降幀間隔處理，而不是丟棄每一幀
+class RealtimeIngestPolicy {
+public:
+    RealtimeIngestPolicy(const RealtimeConfig& config, IngestStats& stats);
+
+    // 為剛擷取的影格設定截止時間
+    void stamp(TimedFrame& frame) const;
+
+    // 依目前的降幀間隔決定是否放行此影格 (擷取執行緒呼叫)
+    bool shouldAdmit(uint64_t sequence);
+
+    // 以近期處理時間預估此影格能否在截止時間前完成；不能且 newer_frame_waiting 時計入 late 並回傳 true。
+    // 沒有更新的影格在等待時一律回傳 false：丟棄它只會讓推論端空轉，預估值與降幀間隔也不再更新
+    bool wouldMissDeadline(const TimedFrame& frame, SteadyClock::time_point now, bool newer_frame_waiting);
+
+    // 回報一幀的處理時間與完成時間，更新預估值與降幀間隔
+    void recordCompletion(const TimedFrame& frame, double processing_ms, SteadyClock::time_point finished);
+
+    int stride() const { return _stride.load(std::memory_order_relaxed); }
+    double expectedProcessingMs() const { return _expected_processing_ms.load(std::memory_order_relaxed); }
+
+private:
+    RealtimeConfig _config;
+    IngestStats& _stats;
+    std::atomic<int> _stride;                    // 每 _stride 幀放行 1 幀
+    std::atomic<double> _expected_processing_ms; // 處理時間的指數移動平均
+    int _overloaded_streak;                      // 連續超出預算的幀數 (僅推論執行緒存取)
+    int _idle_streak;                            // 連續明顯低於預算的幀數 (僅推論執行緒存取)
+};
+
+// 印出目前的計數器
+void printIngestStats(const IngestStats& stats, const RealtimeIngestPolicy& policy, size_t queue_depth);
+
+// 將計數器與降幀間隔登記為輸出時讀取的指標；callbacks 離開作用域時自動移除
+void exportIngestMetrics(const IngestStats& stats, const RealtimeIngestPolicy& policy,
+                         ScopedMetricCallbacks& callbacks);
+
+#endif // YOLO_REALTIME_INGEST_H
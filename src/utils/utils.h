@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <streambuf>
 #include <chrono> // For timing
 
 // 讀取 YOLO 模型所需的類別名稱文件 (例如 coco.names)
@@ -26,4 +27,10 @@ private:
     std::chrono::high_resolution_clock::time_point start_time;
 };
 
+// 丟棄所有輸出的 streambuf；量測時暫時替換 std::cout 的 rdbuf，避免各模組每幀的除錯輸出影響結果
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
 #endif // UTILS_H
\ No newline at end of file
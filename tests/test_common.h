@@ -0,0 +1,66 @@
+// tests/test_common.h
+// 測試共用的簡易檢查巨集與流程輔助函數；不依賴外部測試框架
+#ifndef YOLO_TEST_COMMON_H
+#define YOLO_TEST_COMMON_H
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <onnxruntime_cxx_api.h>
+#include <opencv2/opencv.hpp>
+#include "inference/inference.h"
+#include "postprocess/postprocess.h"
+#include "preprocess/preprocess.h"
+#include "utils/utils.h" // NullBuffer
+
+inline int g_test_failures = 0;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond     \
+                      << std::endl;                                                  \
+            ++g_test_failures;                                                       \
+        }                                                                            \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                      \
+    do {                                                                             \
+        double _a = (actual), _e = (expected);                                       \
+        if (std::fabs(_a - _e) > (tolerance)) {                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_NEAR failed: " #actual \
+                      << " = " << _a << ", expected " << _e << " +/- " << (tolerance) \
+                      << std::endl;                                                  \
+            ++g_test_failures;                                                       \
+        }                                                                            \
+    } while (0)
+
+// 回傳測試程式的結束碼並印出摘要
+inline int testResult(const std::string& name) {
+    if (g_test_failures == 0) {
+        std::cerr << "[PASS] " << name << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAIL] " << name << ": " << g_test_failures << " check(s) failed" << std::endl;
+    return 1;
+}
+
+// 只使用 CPU 的 Session 設定，測試不依賴 GPU
+inline Ort::SessionOptions cpuSessionOptions() {
+    Ort::SessionOptions session_options;
+    session_options.SetGraphOptimizationLevel(ORT_ENABLE_BASIC);
+    session_options.SetIntraOpNumThreads(1); // 單執行緒使延遲量測更穩定
+    return session_options;
+}
+
+// 與 main.cpp 相同的單幀流程：LetterBox -> 正規化 -> 推論 -> NMS -> 坐標恢復
+inline std::vector<Detection> runPipeline(YOLOv12Inference& yolo, const cv::Mat& image, float nms_threshold) {
+    LetterBoxInfo info = letterbox(image, yolo._input_width, yolo._input_height);
+    cv::Mat blob = normalizeAndTranspose(info.processed_image);
+    std::vector<Detection> raw = yolo.runInference(blob);
+    std::vector<Detection> kept = nonMaximumSuppression(raw, nms_threshold);
+    return scaleDetections(kept, info, image.cols, image.rows);
+}
+
+#endif // YOLO_TEST_COMMON_H
@@ -0,0 +1,171 @@
+// tests/test_golden_detections.cpp
+// 以固定的小模型跑完整流程，與 golden 檔比對檢測結果 (類別、分數、框)
+//
+// Usage: test_golden_detections <model.onnx> <images_dir> <golden.txt> <class_names>
+// 設定 YOLO_GOLDEN_UPDATE=1 時改為以目前結果重寫 golden 檔
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "test_common.h"
+#include "utils/utils.h"
+
+namespace {
+
+const float kConfThreshold = 0.25f;
+const float kNmsThreshold = 0.45f;
+const double kScoreTolerance = 2e-3; // 不同 OpenCV 版本的 resize 捨入差異
+const int kBoxTolerance = 1;         // 坐標恢復時的整數截斷差異
+
+struct GoldenEntry {
+    int class_id;
+    float score;
+    cv::Rect bbox;
+};
+
+// 依檔案中出現的順序保存各圖片的 golden 結果
+struct GoldenSet {
+    std::vector<std::string> images;
+    std::map<std::string, std::vector<GoldenEntry>> entries;
+};
+
+GoldenSet loadGolden(const std::string& path) {
+    GoldenSet golden;
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        throw std::runtime_error("無法開啟 golden 檔: " + path);
+    }
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        std::string image;
+        GoldenEntry entry;
+        if (!(iss >> image >> entry.class_id >> entry.score >> entry.bbox.x >> entry.bbox.y
+                  >> entry.bbox.width >> entry.bbox.height)) {
+            throw std::runtime_error("golden 檔格式錯誤: " + line);
+        }
+        if (!golden.entries.count(image)) golden.images.push_back(image);
+        golden.entries[image].push_back(entry);
+    }
+    return golden;
+}
+
+void writeGolden(const std::string& path, const GoldenSet& golden) {
+    std::ofstream ofs(path);
+    if (!ofs.is_open()) {
+        throw std::runtime_error("無法寫入 golden 檔: " + path);
+    }
+    ofs << "# tests/tools/make_tiny_model.py 產生的模型在 images/ 上的檢測結果 (conf " << kConfThreshold
+        << ", nms " << kNmsThreshold << ")\n";
+    ofs << "# 格式: image class_id score x y w h   (x y w h 為原圖坐標)\n";
+    ofs << "# 以 YOLO_GOLDEN_UPDATE=1 執行 golden_detections 測試可重新產生此檔\n";
+    for (const auto& image : golden.images) {
+        for (const auto& entry : golden.entries.at(image)) {
+            ofs << image << " " << entry.class_id << " " << std::fixed << std::setprecision(6) << entry.score
+                << " " << entry.bbox.x << " " << entry.bbox.y << " " << entry.bbox.width << " "
+                << entry.bbox.height << "\n";
+        }
+    }
+}
+
+void compareDetections(const std::string& label,
+                       const std::vector<Detection>& actual,
+                       const std::vector<GoldenEntry>& expected) {
+    if (actual.size() != expected.size()) {
+        std::cerr << label << ": 檢測數 " << actual.size() << "，預期 " << expected.size() << std::endl;
+        ++g_test_failures;
+        return;
+    }
+    // 兩邊都依分數遞減排列 (NMS 的輸出順序)
+    for (size_t i = 0; i < actual.size(); ++i) {
+        const Detection& det = actual[i];
+        const GoldenEntry& gold = expected[i];
+        bool match = det.class_id == gold.class_id &&
+                     std::fabs(det.score - gold.score) <= kScoreTolerance &&
+                     std::abs(det.bbox.x - gold.bbox.x) <= kBoxTolerance &&
+                     std::abs(det.bbox.y - gold.bbox.y) <= kBoxTolerance &&
+                     std::abs(det.bbox.width - gold.bbox.width) <= kBoxTolerance &&
+                     std::abs(det.bbox.height - gold.bbox.height) <= kBoxTolerance;
+        if (!match) {
+            std::cerr << label << " #" << i << ": 得到 class " << det.class_id << " score " << det.score
+                      << " box " << det.bbox << "，預期 class " << gold.class_id << " score " << gold.score
+                      << " box " << gold.bbox << std::endl;
+            ++g_test_failures;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " <model.onnx> <images_dir> <golden.txt> <class_names>" << std::endl;
+        return 2;
+    }
+    std::string model_path = argv[1];
+    std::string images_dir = argv[2];
+    std::string golden_path = argv[3];
+    std::vector<std::string> class_names = loadClassNames(argv[4]);
+    const char* update_env = std::getenv("YOLO_GOLDEN_UPDATE");
+    bool update = update_env && std::string(update_env) == "1";
+
+    NullBuffer null_buffer;
+    std::streambuf* original_cout = std::cout.rdbuf(&null_buffer);
+
+    try {
+        GoldenSet golden = loadGolden(golden_path);
+        YOLOv12Inference yolo(model_path, class_names, cpuSessionOptions(), kConfThreshold);
+
+        if (update) {
+            GoldenSet refreshed;
+            for (const auto& image_name : golden.images) {
+                cv::Mat image = cv::imread(images_dir + "/" + image_name);
+                CHECK(!image.empty());
+                refreshed.images.push_back(image_name);
+                for (const auto& det : runPipeline(yolo, image, kNmsThreshold)) {
+                    refreshed.entries[image_name].push_back({det.class_id, det.score, det.bbox});
+                }
+            }
+            writeGolden(golden_path, refreshed);
+            std::cout.rdbuf(original_cout);
+            std::cerr << "已更新 golden 檔: " << golden_path << std::endl;
+            return testResult("golden_detections");
+        }
+
+        // 1. 全部類別
+        for (const auto& image_name : golden.images) {
+            cv::Mat image = cv::imread(images_dir + "/" + image_name);
+            CHECK(!image.empty());
+            if (image.empty()) continue;
+            compareDetections(image_name, runPipeline(yolo, image, kNmsThreshold), golden.entries[image_name]);
+        }
+
+        // 2. 類別過濾：結果應為 golden 中符合過濾條件的子集
+        //    (car 與 dog 未與其他類別的框重疊，因此關閉其他類別不影響 NMS)
+        ClassFilter filter = ClassFilter::parse("car,dog:0.5", class_names);
+        YOLOv12Inference filtered(model_path, class_names, cpuSessionOptions(), kConfThreshold, filter);
+        for (const auto& image_name : golden.images) {
+            cv::Mat image = cv::imread(images_dir + "/" + image_name);
+            if (image.empty()) continue;
+            std::vector<GoldenEntry> expected;
+            for (const auto& entry : golden.entries[image_name]) {
+                bool enabled = std::find(filter.enabled_classes.begin(), filter.enabled_classes.end(),
+                                         entry.class_id) != filter.enabled_classes.end();
+                auto threshold = filter.class_thresholds.find(entry.class_id);
+                float min_score = threshold == filter.class_thresholds.end() ? kConfThreshold : threshold->second;
+                if (enabled && entry.score >= min_score) expected.push_back(entry);
+            }
+            compareDetections(image_name + " [car,dog:0.5]", runPipeline(filtered, image, kNmsThreshold), expected);
+        }
+    } catch (const std::exception& e) {
+        std::cout.rdbuf(original_cout);
+        std::cerr << "golden_detections 執行失敗: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout.rdbuf(original_cout);
+    return testResult("golden_detections");
+}
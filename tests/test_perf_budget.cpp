@@ -0,0 +1,212 @@
+// tests/test_perf_budget.cpp
+// 各階段延遲的回歸門檻：量測每個階段的中位數，與此主機的延遲預算比較
+//
+// Usage: test_perf_budget <model.onnx> <images_dir> <budget_dir>
+// 預算檔每行 "stage median_ms"，依主機存放在 <budget_dir>/<host>.txt (預設為版本庫的 tests/perf_budgets)。
+// 主機鍵為 YOLO_PERF_HOST (未設定時使用 hostname)。延遲只在同一台主機上才有比較意義，
+// 因此沒有跨主機的後備預算：此主機沒有預算檔時回傳 kSkipReturnCode，由 CTest 標示為略過而不是通過。
+// 只有 YOLO_PERF_UPDATE=1 時才把本次量測寫入 <budget_dir>/<host>.txt (寫入後仍照常比較)，
+// 產生的檔案應與造成延遲變化的修改一起提交。
+// YOLO_PERF_TOLERANCE 設定允許的相對退步比例 (預設 0.3，即慢 30% 以內視為通過)
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "test_common.h"
+
+namespace {
+
+const float kConfThreshold = 0.25f;
+const float kNmsThreshold = 0.45f;
+const int kWarmupIterations = 5;
+const int kMeasureIterations = 50;
+const double kAbsoluteSlackMs = 0.01; // 亞毫秒級階段的計時抖動；遠小於 letterbox/normalize 的中位數，慢一倍即超出上限
+const double kDefaultTolerance = 0.3;
+const int kSkipReturnCode = 77; // 與 CMakeLists.txt 的 SKIP_RETURN_CODE 一致
+
+const std::vector<std::string> kStages = {"letterbox", "normalize", "inference", "nms", "scale", "draw"};
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    return values[mid];
+}
+
+std::string hostName() {
+    if (const char* host_env = std::getenv("YOLO_PERF_HOST")) {
+        if (host_env[0] != '\0') return host_env; // CI 的 hostname 每次不同，以固定的鍵代替
+    }
+    char name[256] = {0};
+    if (gethostname(name, sizeof(name) - 1) != 0 || name[0] == '\0') {
+        return "unknown-host";
+    }
+    return name;
+}
+
+std::map<std::string, double> loadBudget(const std::string& path) {
+    std::map<std::string, double> budget;
+    std::ifstream ifs(path);
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        std::string stage;
+        double ms;
+        if (iss >> stage >> ms) budget[stage] = ms;
+    }
+    return budget;
+}
+
+void writeBudget(const std::string& path, const std::map<std::string, double>& medians) {
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    std::ofstream ofs(path);
+    if (!ofs.is_open()) {
+        throw std::runtime_error("無法寫入延遲預算檔: " + path);
+    }
+    ofs << "# " << hostName() << " 的各階段延遲預算 (中位數, ms)；由 perf_budget 測試產生\n";
+    for (const auto& stage : kStages) {
+        ofs << stage << " " << std::fixed << std::setprecision(4) << medians.at(stage) << "\n";
+    }
+}
+
+// 逐階段量測完整流程，每個階段各自計時
+std::map<std::string, double> measureStageMedians(YOLOv12Inference& yolo, const std::vector<cv::Mat>& images) {
+    std::map<std::string, std::vector<double>> samples;
+    for (int iter = 0; iter < kWarmupIterations + kMeasureIterations; ++iter) {
+        bool record = iter >= kWarmupIterations;
+        for (const auto& image : images) {
+            auto start = std::chrono::steady_clock::now();
+            LetterBoxInfo info = letterbox(image, yolo._input_width, yolo._input_height);
+            double letterbox_ms = elapsedMs(start);
+
+            start = std::chrono::steady_clock::now();
+            cv::Mat blob = normalizeAndTranspose(info.processed_image);
+            double normalize_ms = elapsedMs(start);
+
+            start = std::chrono::steady_clock::now();
+            std::vector<Detection> raw = yolo.runInference(blob);
+            double inference_ms = elapsedMs(start);
+
+            start = std::chrono::steady_clock::now();
+            std::vector<Detection> kept = nonMaximumSuppression(raw, kNmsThreshold);
+            double nms_ms = elapsedMs(start);
+
+            start = std::chrono::steady_clock::now();
+            std::vector<Detection> scaled = scaleDetections(kept, info, image.cols, image.rows);
+            double scale_ms = elapsedMs(start);
+
+            cv::Mat canvas = image.clone(); // 繪製會修改圖像，複製不計入時間
+            start = std::chrono::steady_clock::now();
+            drawDetections(canvas, scaled);
+            double draw_ms = elapsedMs(start);
+
+            if (record) {
+                samples["letterbox"].push_back(letterbox_ms);
+                samples["normalize"].push_back(normalize_ms);
+                samples["inference"].push_back(inference_ms);
+                samples["nms"].push_back(nms_ms);
+                samples["scale"].push_back(scale_ms);
+                samples["draw"].push_back(draw_ms);
+            }
+        }
+    }
+    std::map<std::string, double> medians;
+    for (const auto& stage : kStages) {
+        medians[stage] = median(samples[stage]);
+    }
+    return medians;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <model.onnx> <images_dir> <budget_dir>" << std::endl;
+        return 2;
+    }
+    std::string model_path = argv[1];
+    std::string images_dir = argv[2];
+    std::string budget_path = std::string(argv[3]) + "/" + hostName() + ".txt";
+
+    const char* update_env = std::getenv("YOLO_PERF_UPDATE");
+    bool update = update_env && std::string(update_env) == "1";
+    double tolerance = kDefaultTolerance;
+    if (const char* tolerance_env = std::getenv("YOLO_PERF_TOLERANCE")) {
+        try {
+            tolerance = std::stod(tolerance_env);
+        } catch (const std::exception&) {
+            std::cerr << "警告: 無效的 YOLO_PERF_TOLERANCE '" << tolerance_env << "'，使用預設值 "
+                      << kDefaultTolerance << std::endl;
+        }
+    }
+
+    std::vector<cv::Mat> images;
+    std::vector<cv::String> image_paths;
+    cv::glob(images_dir + "/*.jpg", image_paths);
+    for (const auto& path : image_paths) {
+        cv::Mat image = cv::imread(path);
+        if (!image.empty()) images.push_back(image);
+    }
+    if (images.empty()) {
+        std::cerr << "找不到測試圖片: " << images_dir << std::endl;
+        return 1;
+    }
+
+    // 各模組每幀都有除錯輸出；量測時丟棄，避免終端輸出的速度影響結果
+    NullBuffer null_buffer;
+    std::streambuf* original_cout = std::cout.rdbuf(&null_buffer);
+    std::map<std::string, double> medians;
+    try {
+        std::vector<std::string> class_names(80);
+        for (size_t i = 0; i < class_names.size(); ++i) class_names[i] = "class" + std::to_string(i);
+        YOLOv12Inference yolo(model_path, class_names, cpuSessionOptions(), kConfThreshold);
+        medians = measureStageMedians(yolo, images);
+    } catch (const std::exception& e) {
+        std::cout.rdbuf(original_cout);
+        std::cerr << "perf_budget 執行失敗: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout.rdbuf(original_cout);
+
+    if (update) {
+        writeBudget(budget_path, medians);
+        std::cerr << "已更新: " << budget_path << std::endl;
+    }
+
+    std::map<std::string, double> budget = loadBudget(budget_path);
+    if (budget.empty()) {
+        std::cerr << "此主機沒有延遲預算 (" << budget_path << ")，略過；"
+                  << "以 YOLO_PERF_UPDATE=1 執行可建立本機預算" << std::endl;
+        for (const auto& stage : kStages) {
+            std::cerr << "  " << std::left << std::setw(10) << stage << std::fixed << std::setprecision(4)
+                      << medians[stage] << " ms" << std::endl;
+        }
+        return kSkipReturnCode;
+    }
+
+    std::cerr << "延遲預算: " << budget_path << " (容許 +" << tolerance * 100 << "%)" << std::endl;
+    for (const auto& stage : kStages) {
+        auto it = budget.find(stage);
+        if (it == budget.end()) {
+            std::cerr << "  " << std::left << std::setw(10) << stage << "預算檔中沒有此階段，略過" << std::endl;
+            continue;
+        }
+        double limit = it->second * (1.0 + tolerance) + kAbsoluteSlackMs;
+        bool within = medians[stage] <= limit;
+        std::cerr << "  " << std::left << std::setw(10) << stage << std::fixed << std::setprecision(4)
+                  << medians[stage] << " ms  (預算 " << it->second << " ms, 上限 " << limit << " ms)"
+                  << (within ? "" : "  <-- 超出預算") << std::endl;
+        if (!within) ++g_test_failures;
+    }
+    return testResult("perf_budget");
+}
@@ -0,0 +1,470 @@
+// tests/test_pipeline_units.cpp
+// 不需要模型的單元測試：letterbox、正規化、NMS、坐標恢復、類別過濾設定的解析，
+// 即時攝取的緩衝區與截止時間/降幀策略 (以合成的時間點驅動，不依賴實際耗時)，
+// 共享記憶體影格環形緩衝區 (seqlock、跳幀計數、重新連接與標頭驗證)，以及指標的直方圖與 Prometheus 輸出
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <new>
+#include <thread>
+#include "test_common.h"
+#include "ipc/shm_frame_consumer.h"
+#include "ipc/shm_frame_producer.h"
+#include "metrics/metrics.h"
+#include "realtime/realtime_ingest.h"
+
+static void testLetterbox() {
+    cv::Mat image(480, 640, CV_8UC3, cv::Scalar(10, 20, 30));
+    LetterBoxInfo info = letterbox(image, 64, 64);
+
+    CHECK_NEAR(info.scale, 0.1, 1e-6);
+    CHECK(info.pad_x == 0);
+    CHECK(info.pad_y == 8);
+    CHECK(info.processed_image.cols == 64);
+    CHECK(info.processed_image.rows == 64);
+    // 上方填充區為灰色 (128)，影像區保留原始顏色
+    cv::Vec3b pad_pixel = info.processed_image.at<cv::Vec3b>(0, 0);
+    CHECK(pad_pixel[0] == 128 && pad_pixel[1] == 128 && pad_pixel[2] == 128);
+    cv::Vec3b image_pixel = info.processed_image.at<cv::Vec3b>(32, 32);
+    CHECK(image_pixel[0] == 10 && image_pixel[1] == 20 && image_pixel[2] == 30);
+}
+
+static void testNormalizeAndTranspose() {
+    cv::Mat image(32, 48, CV_8UC3, cv::Scalar(255, 255, 255));
+    cv::Mat blob = normalizeAndTranspose(image);
+
+    CHECK(blob.dims == 4);
+    CHECK(blob.size[0] == 1 && blob.size[1] == 3 && blob.size[2] == 32 && blob.size[3] == 48);
+    CHECK(blob.type() == CV_32F);
+    const float* data = blob.ptr<float>();
+    CHECK_NEAR(data[0], 1.0, 1e-6);
+    CHECK_NEAR(data[blob.total() - 1], 1.0, 1e-6);
+
+    // 寫入預先配置的 blob 時不可重新配置
+    int dims[4] = {1, 3, 32, 48};
+    cv::Mat preallocated(4, dims, CV_32F, cv::Scalar(0));
+    const uchar* before = preallocated.data;
+    normalizeAndTranspose(image, preallocated);
+    CHECK(preallocated.data == before);
+    CHECK_NEAR(preallocated.ptr<float>()[0], 1.0, 1e-6);
+}
+
+static Detection makeDetection(int x, int y, int w, int h, float score, int class_id) {
+    Detection det;
+    det.bbox = cv::Rect(x, y, w, h);
+    det.score = score;
+    det.class_id = class_id;
+    det.class_name = std::to_string(class_id);
+    return det;
+}
+
+static void testNonMaximumSuppression() {
+    std::vector<Detection> detections = {
+        makeDetection(10, 10, 20, 30, 0.6f, 0),
+        makeDetection(11, 11, 20, 30, 0.9f, 0),   // 與第一個框高度重疊，分數較高
+        makeDetection(100, 100, 10, 10, 0.5f, 1), // 不重疊
+    };
+    std::vector<Detection> kept = nonMaximumSuppression(detections, 0.45f);
+
+    CHECK(kept.size() == 2);
+    if (kept.size() == 2) {
+        CHECK_NEAR(kept[0].score, 0.9, 1e-6); // 依分數排序
+        CHECK(kept[0].bbox.x == 11);
+        CHECK(kept[1].class_id == 1);
+    }
+
+    std::vector<Detection> empty;
+    CHECK(nonMaximumSuppression(empty, 0.45f).empty());
+}
+
+static void testScaleDetections() {
+    LetterBoxInfo info;
+    info.scale = 0.5f;
+    info.pad_x = 0;
+    info.pad_y = 10;
+
+    std::vector<Detection> detections = {
+        makeDetection(10, 30, 20, 40, 0.9f, 0),
+        makeDetection(-4, 5, 300, 300, 0.8f, 1), // 超出原圖，需要裁切
+    };
+    std::vector<Detection> scaled = scaleDetections(detections, info, 200, 150);
+
+    CHECK(scaled.size() == 2);
+    if (scaled.size() == 2) {
+        CHECK(scaled[0].bbox.x == 20);
+        CHECK(scaled[0].bbox.y == 40);
+        CHECK(scaled[0].bbox.width == 40);
+        CHECK(scaled[0].bbox.height == 80);
+
+        CHECK(scaled[1].bbox.x == 0);
+        CHECK(scaled[1].bbox.y == 0);
+        CHECK(scaled[1].bbox.width == 200);
+        CHECK(scaled[1].bbox.height == 150);
+    }
+}
+
+static void testClassFilterParse() {
+    std::vector<std::string> names = {"person", "bicycle", "car", "motorcycle", "airplane", "bus"};
+    NullBuffer null_buffer;
+    std::streambuf* original_cerr = std::cerr.rdbuf(&null_buffer); // 略過未知類別的警告 (含超出 int 範圍的 ID)
+    ClassFilter filter = ClassFilter::parse("person:0.4,car,5:0.3,unknown,bus:abc,99999999999", names);
+    std::cerr.rdbuf(original_cerr);
+
+    CHECK(filter.enabled_classes.size() == 3);
+    if (filter.enabled_classes.size() == 3) {
+        CHECK(filter.enabled_classes[0] == 0);
+        CHECK(filter.enabled_classes[1] == 2);
+        CHECK(filter.enabled_classes[2] == 5);
+    }
+    CHECK(filter.class_thresholds.size() == 2);
+    CHECK_NEAR(filter.class_thresholds[0], 0.4, 1e-6);
+    CHECK_NEAR(filter.class_thresholds[5], 0.3, 1e-6);
+    CHECK(filter.class_thresholds.count(2) == 0); // 未指定閾值的類別使用全域閾值
+
+    CHECK(ClassFilter::parse("", names).enabled_classes.empty());
+}
+
+static TimedFrame makeFrame(uint64_t sequence, SteadyClock::time_point capture_time) {
+    TimedFrame frame;
+    frame.sequence = sequence;
+    frame.capture_time = capture_time;
+    return frame;
+}
+
+static void testLatestFrameRing() {
+    IngestStats stats;
+    LatestFrameRing ring(2, stats);
+    SteadyClock::time_point t0 = SteadyClock::now();
+
+    // 滿時覆蓋最舊的影格
+    for (uint64_t i = 0; i < 3; ++i) ring.push(makeFrame(i, t0));
+    CHECK(ring.depth() == 2);
+    CHECK(stats.overwritten.load() == 1);
+
+    TimedFrame out;
+    CHECK(ring.pop(out, std::chrono::milliseconds(0)));
+    CHECK(out.sequence == 1);
+    CHECK(ring.pop(out, std::chrono::milliseconds(0)));
+    CHECK(out.sequence == 2);
+    CHECK(!ring.pop(out, std::chrono::milliseconds(0))); // 空且逾時
+
+    // close() 喚醒等待中的 pop()，之後的 push() 被忽略
+    bool popped = true;
+    std::thread waiter([&]() { popped = ring.pop(out, std::chrono::milliseconds(5000)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto close_time = SteadyClock::now();
+    ring.close();
+    waiter.join();
+    CHECK(!popped);
+    CHECK(SteadyClock::now() - close_time < std::chrono::milliseconds(1000));
+    ring.push(makeFrame(3, t0));
+    CHECK(ring.depth() == 0);
+}
+
+static void testRealtimeIngestPolicy() {
+    RealtimeConfig config;
+    config.frame_budget_ms = 100.0;
+    config.max_stride = 4;
+    config.adapt_window = 3;
+    config.recover_ratio = 0.5;
+    IngestStats stats;
+    RealtimeIngestPolicy policy(config, stats);
+
+    SteadyClock::time_point t0 = SteadyClock::now();
+    auto ms = [](int n) { return std::chrono::milliseconds(n); };
+
+    // 以指定的端到端延遲完成一幀
+    uint64_t sequence = 0;
+    auto complete = [&](int latency_ms, double processing_ms) {
+        TimedFrame frame = makeFrame(sequence++, t0);
+        policy.stamp(frame);
+        policy.recordCompletion(frame, processing_ms, t0 + ms(latency_ms));
+    };
+
+    TimedFrame frame = makeFrame(0, t0);
+    policy.stamp(frame);
+    CHECK(frame.deadline == t0 + ms(100));
+
+    // 沒有處理時間預估時不丟棄
+    CHECK(!policy.wouldMissDeadline(frame, t0, true));
+
+    // 第一幀直接採用量測值，之後為 EMA
+    complete(150, 150.0);
+    CHECK_NEAR(policy.expectedProcessingMs(), 150.0, 1e-9);
+    CHECK(stats.deadline_missed.load() == 1);
+
+    // 預估無法準時完成：有更新的影格等待時丟棄，最新影格一律處理
+    CHECK(!policy.wouldMissDeadline(frame, t0, false));
+    CHECK(stats.late.load() == 0);
+    CHECK(policy.wouldMissDeadline(frame, t0, true));
+    CHECK(stats.late.load() == 1);
+    // 剩餘時間足夠時不丟棄
+    frame.deadline = t0 + ms(500);
+    CHECK(!policy.wouldMissDeadline(frame, t0, true));
+
+    // 持續過載：每 adapt_window 幀倍增降幀間隔，直到 max_stride
+    complete(150, 150.0);
+    complete(150, 150.0); // 連續第 3 幀過載
+    CHECK(policy.stride() == 2);
+    for (int i = 0; i < 3; ++i) complete(150, 150.0);
+    CHECK(policy.stride() == 4);
+    for (int i = 0; i < 3; ++i) complete(150, 150.0);
+    CHECK(policy.stride() == 4);
+
+    // 放行每 stride 幀中的 1 幀，其餘計入 shed
+    uint64_t shed_before = stats.shed.load();
+    CHECK(policy.shouldAdmit(8));
+    CHECK(!policy.shouldAdmit(9));
+    CHECK(stats.shed.load() == shed_before + 1);
+
+    // 介於恢復比例與預算之間的延遲會重設連續計數
+    complete(20, 20.0);
+    complete(20, 20.0);
+    complete(70, 70.0);
+    complete(20, 20.0);
+    complete(20, 20.0);
+    CHECK(policy.stride() == 4);
+
+    // 持續空閒：每 adapt_window 幀減一，最低為 1
+    complete(20, 20.0); // 連續第 3 幀空閒
+    CHECK(policy.stride() == 3);
+    for (int i = 0; i < 3; ++i) complete(20, 20.0);
+    CHECK(policy.stride() == 2);
+    for (int i = 0; i < 3; ++i) complete(20, 20.0);
+    CHECK(policy.stride() == 1);
+    for (int i = 0; i < 3; ++i) complete(20, 20.0);
+    CHECK(policy.stride() == 1);
+    CHECK(policy.shouldAdmit(9));
+
+    CHECK(stats.processed.load() == sequence);
+}
+
+// 每個測試程序使用自己的名稱，平行執行的 ctest 不會互相干擾
+static std::string testShmName(const std::string& suffix) {
+    return "/yolo_test_" + std::to_string(getpid()) + "_" + suffix;
+}
+
+// 發布一幀內容全為 value 的影格
+static uint64_t publishFilled(ShmFrameProducer& producer, uint8_t value) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(producer.width()) * 3 * producer.height(), value);
+    return producer.publish(pixels.data(), static_cast<size_t>(producer.width()) * 3);
+}
+
+static void testShmRingPublishAndAcquire() {
+    std::string name = testShmName("ring");
+    ShmFrameProducer producer(name, 8, 4, 2);
+    ShmFrameConsumer consumer(name);
+    CHECK(consumer.width() == 8 && consumer.height() == 4);
+
+    ShmFrameView view;
+    CHECK(!consumer.acquireLatest(view)); // 尚未發布任何影格
+
+    CHECK(publishFilled(producer, 7) == 0);
+    CHECK(consumer.acquireLatest(view));
+    CHECK(view.frame_number == 0);
+    CHECK(view.capture_time_ns > 0);
+    CHECK(view.image.cols == 8 && view.image.rows == 4);
+    CHECK(view.image.step[0] == producer.stride());
+    CHECK(view.image.at<cv::Vec3b>(3, 7)[2] == 7);
+    CHECK(consumer.isValid(view));
+    CHECK(!consumer.hasNewerFrame(view));
+    CHECK(!consumer.acquireLatest(view)); // 同一幀不會取得兩次
+
+    // 取得後 slot 被覆寫：開始寫入時 (序號為奇數) 與提交後都判定為失效
+    ShmFrameView held;
+    publishFilled(producer, 1); // frame 1，slot 1
+    CHECK(consumer.acquireLatest(held));
+    CHECK(held.frame_number == 1);
+    publishFilled(producer, 2); // frame 2，slot 0
+    CHECK(consumer.isValid(held));
+    CHECK(consumer.hasNewerFrame(held));
+    producer.beginFrame();      // frame 3 開始寫入 slot 1
+    CHECK(!consumer.isValid(held));
+    producer.commitFrame();
+    CHECK(!consumer.isValid(held));
+
+    // 跳幀計數：frame 2 未被取得就被 frame 3 取代
+    CHECK(consumer.skippedFrames() == 0);
+    CHECK(consumer.acquireLatest(view));
+    CHECK(view.frame_number == 3);
+    CHECK(consumer.skippedFrames() == 1);
+    for (int i = 0; i < 4; ++i) publishFilled(producer, 3);
+    CHECK(consumer.acquireLatest(view));
+    CHECK(view.frame_number == 7);
+    CHECK(consumer.skippedFrames() == 4);
+
+    // abortFrame() 使該 slot 的持有者失效但不發布：view 為 frame 7 (slot 1)，
+    // 發布 frame 8 (slot 0) 後，放棄的 frame 9 寫入 slot 1
+    publishFilled(producer, 4);
+    producer.beginFrame();
+    producer.abortFrame();
+    CHECK(!consumer.isValid(view));
+    CHECK(consumer.acquireLatest(view));
+    CHECK(view.frame_number == 8);
+    CHECK(!consumer.acquireLatest(view));
+}
+
+static void testShmReconnect() {
+    std::string name = testShmName("reconnect");
+    std::unique_ptr<ShmFrameProducer> producer(new ShmFrameProducer(name, 4, 4, 2));
+    ShmFrameConsumer consumer(name);
+    CHECK(!consumer.sourceReplaced());
+
+    // 擷取端結束：名稱已移除
+    producer.reset();
+    CHECK(consumer.sourceReplaced());
+
+    // 擷取端重新啟動並重建同名共享記憶體：舊連線仍判定為已替換，重新連接後可讀取新來源
+    producer.reset(new ShmFrameProducer(name, 4, 4, 2));
+    CHECK(consumer.sourceReplaced());
+    publishFilled(*producer, 9);
+    ShmFrameConsumer reconnected(name);
+    CHECK(!reconnected.sourceReplaced());
+    ShmFrameView view;
+    CHECK(reconnected.acquireLatest(view));
+    CHECK(view.frame_number == 0);
+    CHECK(view.image.at<cv::Vec3b>(0, 0)[0] == 9);
+}
+
+// 手動建立一塊共享記憶體並以 corrupt 修改標頭，回傳讀取端建構是否拋出異常
+template <typename Corrupt>
+static bool consumerRejects(const std::string& name, Corrupt corrupt) {
+    const uint32_t width = 8, height = 4, slot_count = 2;
+    uint64_t slot_bytes = 0, slots_offset = 0;
+    size_t size = shmRegionSize(width, height, slot_count, &slot_bytes, &slots_offset);
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        if (fd >= 0) close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ShmRingHeader* header = new (region) ShmRingHeader();
+    header->version = kShmFrameVersion;
+    header->slot_count = slot_count;
+    header->width = width;
+    header->height = height;
+    header->stride = shmRowStride(width);
+    header->slot_bytes = slot_bytes;
+    header->slots_offset = slots_offset;
+    header->write_index.store(0);
+    corrupt(*header);
+    header->magic = kShmFrameMagic;
+
+    bool rejected = false;
+    try {
+        ShmFrameConsumer consumer(name);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    munmap(region, size);
+    shm_unlink(name.c_str());
+    return rejected;
+}
+
+static void testShmHeaderValidation() {
+    std::string name = testShmName("header");
+    CHECK(!consumerRejects(name, [](ShmRingHeader&) {})); // 正確的標頭可以連接
+    CHECK(consumerRejects(name, [](ShmRingHeader& h) { h.stride += 64; }));
+    CHECK(consumerRejects(name, [](ShmRingHeader& h) { h.slot_bytes *= 2; }));
+    CHECK(consumerRejects(name, [](ShmRingHeader& h) { h.slots_offset += 4096; }));
+    CHECK(consumerRejects(name, [](ShmRingHeader& h) { h.slot_count = 64; })); // 超出實際大小
+    CHECK(consumerRejects(name, [](ShmRingHeader& h) { h.slot_count = 0; }));
+    CHECK(consumerRejects(name, [](ShmRingHeader& h) { h.width = 0; }));
+    CHECK(consumerRejects(name, [](ShmRingHeader& h) { h.version = kShmFrameVersion + 1; }));
+}
+
+static bool contains(const std::string& text, const std::string& line) {
+    return text.find(line + "\n") != std::string::npos;
+}
+
+static void testHistogram() {
+    Histogram histogram({0.5, 1.0, 2.0});
+    histogram.observe(0.25);
+    histogram.observe(0.5); // 等於上界時計入該桶 (le)
+    histogram.observe(1.5);
+    histogram.observe(10.0); // +Inf
+    CHECK(histogram.bucketCount(0) == 2);
+    CHECK(histogram.bucketCount(1) == 0);
+    CHECK(histogram.bucketCount(2) == 1);
+    CHECK(histogram.bucketCount(3) == 1);
+    CHECK(histogram.count() == 4);
+    CHECK(histogram.sumUnits() == 12250000);
+    CHECK_NEAR(histogram.sum(), 12.25, 1e-12);
+
+    // 以秒記錄的延遲：9 位小數保留次微秒的觀測值
+    Histogram latency({0.001}, 9);
+    latency.observe(0.0000004); // 400 ns
+    latency.observe(0.0000004);
+    CHECK(latency.sumUnits() == 800);
+
+    // nullptr 不記錄；ScopedLatency 以秒寫入
+    { ScopedLatency ignored(static_cast<Histogram*>(nullptr)); }
+    { ScopedLatency timed(latency); }
+    CHECK(latency.count() == 3);
+    CHECK(latency.bucketCount(0) == 3); // 空區塊遠小於 1 ms
+}
+
+static void testRenderPrometheus() {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    registry.counter("test_requests_total", "Requests.", "code=\"200\"").inc(1234567);
+    registry.gauge("test_queue_depth", "Depth.").set(-3);
+    Histogram& histogram = registry.histogram("test_latency_seconds", "Latency.", {0.001, 0.01},
+                                              "stage=\"a\"", 9);
+    histogram.observe(0.0005);
+    histogram.observe(0.002);
+    histogram.observe(0.5);
+
+    std::string text;
+    {
+        ScopedMetricCallbacks callbacks;
+        callbacks.add("test_callback_total", "Callback counter.", "counter", "", []() { return 98765432.0; });
+        callbacks.add("test_callback_ratio", "Callback gauge.", "gauge", "", []() { return 0.1; });
+        text = registry.renderPrometheus();
+    }
+    CHECK(contains(text, "# HELP test_requests_total Requests."));
+    CHECK(contains(text, "# TYPE test_requests_total counter"));
+    CHECK(contains(text, "test_requests_total{code=\"200\"} 1234567"));
+    CHECK(contains(text, "test_queue_depth -3"));
+    CHECK(contains(text, "# TYPE test_latency_seconds histogram"));
+    CHECK(contains(text, "test_latency_seconds_bucket{stage=\"a\",le=\"0.001\"} 1"));
+    CHECK(contains(text, "test_latency_seconds_bucket{stage=\"a\",le=\"0.01\"} 2")); // 累積
+    CHECK(contains(text, "test_latency_seconds_bucket{stage=\"a\",le=\"+Inf\"} 3"));
+    CHECK(contains(text, "test_latency_seconds_sum{stage=\"a\"} 0.502500000"));
+    CHECK(contains(text, "test_latency_seconds_count{stage=\"a\"} 3"));
+    CHECK(contains(text, "test_callback_total 98765432")); // 整數不以科學記號輸出
+    CHECK(contains(text, "test_callback_ratio 0.10000000000000001"));
+
+    // 離開作用域後回呼被移除
+    text = registry.renderPrometheus();
+    CHECK(text.find("test_callback_total") == std::string::npos);
+    CHECK(contains(text, "test_requests_total{code=\"200\"} 1234567"));
+
+    // 流程指標以秒為單位
+    pipelineMetrics();
+    text = registry.renderPrometheus();
+    CHECK(contains(text, "# TYPE yolo_stage_latency_seconds histogram"));
+    CHECK(text.find("yolo_stage_latency_ms") == std::string::npos);
+}
+
+int main() {
+    NullBuffer null_buffer;
+    std::streambuf* original_cout = std::cout.rdbuf(&null_buffer);
+
+    testLetterbox();
+    testNormalizeAndTranspose();
+    testNonMaximumSuppression();
+    testScaleDetections();
+    testClassFilterParse();
+    testLatestFrameRing();
+    testRealtimeIngestPolicy();
+    testShmRingPublishAndAcquire();
+    testShmReconnect();
+    testShmHeaderValidation();
+    testHistogram();
+    testRenderPrometheus();
+
+    std::cout.rdbuf(original_cout);
+    return testResult("pipeline_units");
+}
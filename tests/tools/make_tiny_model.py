@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""產生測試用的極小 YOLO 格式 ONNX 模型 (只需 onnx 套件，不需網路)。
+
+輸入 images: [1, 3, 64, 64] float32
+輸出 output0: [1, 4 + 80, 8] float32，與 YOLOv8/v12 相同的 [1, attributes, boxes] 排列
+
+8 個框的坐標是常數 (模型輸入空間的 x1, y1, x2, y2)，類別分數為常數乘上
+2 * mean(images)，因此結果會隨 letterbox/正規化的輸出改變，但仍可精確重現。
+
+Usage: make_tiny_model.py <output.onnx>
+"""
+import sys
+
+import numpy as np
+import onnx
+from onnx import TensorProto, helper, numpy_helper
+
+INPUT_SIZE = 64
+NUM_CLASSES = 80
+BACKGROUND_SCORE = 0.01
+
+# (class_id, base_score, x1, y1, x2, y2)
+BOXES = [
+    (0, 0.90, 8, 8, 30, 40),     # person
+    (0, 0.80, 9, 9, 31, 41),     # 與第 0 個框高度重疊，NMS 應抑制
+    (2, 0.70, 34, 20, 60, 44),   # car
+    (16, 0.55, 2, 44, 20, 62),   # dog
+    (5, 0.60, 40, 2, 62, 18),    # bus
+    (7, 0.10, 20, 20, 40, 40),   # 低於置信度閾值
+    (2, 0.40, 35, 21, 59, 43),   # 與 car 重疊，NMS 應抑制
+    (56, 0.45, 0, 0, 10, 10),    # chair
+]
+
+
+def build_model():
+    num_boxes = len(BOXES)
+    coords = np.zeros((1, 4, num_boxes), dtype=np.float32)
+    scores = np.full((1, NUM_CLASSES, num_boxes), BACKGROUND_SCORE, dtype=np.float32)
+    for i, (class_id, score, x1, y1, x2, y2) in enumerate(BOXES):
+        coords[0, :, i] = (x1, y1, x2, y2)
+        scores[0, class_id, i] = score
+
+    nodes = [
+        helper.make_node("ReduceMean", ["images"], ["mean"], keepdims=1),  # [1, 1, 1, 1]
+        helper.make_node("Reshape", ["mean", "mean_shape"], ["mean_3d"]),   # [1, 1, 1]
+        helper.make_node("Mul", ["mean_3d", "two"], ["gain"]),
+        helper.make_node("Mul", ["base_scores", "gain"], ["class_scores"]),
+        helper.make_node("Concat", ["box_coords", "class_scores"], ["output0"], axis=1),
+    ]
+    initializers = [
+        numpy_helper.from_array(coords, "box_coords"),
+        numpy_helper.from_array(scores, "base_scores"),
+        numpy_helper.from_array(np.array([1, 1, 1], dtype=np.int64), "mean_shape"),
+        numpy_helper.from_array(np.array(2.0, dtype=np.float32), "two"),
+    ]
+    graph = helper.make_graph(
+        nodes,
+        "tiny_yolo",
+        [helper.make_tensor_value_info("images", TensorProto.FLOAT, [1, 3, INPUT_SIZE, INPUT_SIZE])],
+        [helper.make_tensor_value_info("output0", TensorProto.FLOAT, [1, 4 + NUM_CLASSES, num_boxes])],
+        initializers,
+    )
+    # opset 13 / IR 8：ONNX Runtime 1.14 以後的版本都能載入
+    model = helper.make_model(graph, opset_imports=[helper.make_opsetid("", 13)])
+    model.ir_version = 8
+    onnx.checker.check_model(model)
+    return model
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__, file=sys.stderr)
+        return 1
+    onnx.save(build_model(), sys.argv[1])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,100 @@
+// tools/shm_capture_producer.cpp
+// 擷取程序範例：從攝影機或影片讀取影格，直接解碼進共享記憶體 slot，
+// 偵測程序以 "shm:/name" 作為輸入即可零複製讀取。
+//
+// Usage: shm_capture_producer <camera_index|path_to_video> [/shm_name] [slot_count]
+// 收到 SIGINT/SIGTERM 時結束迴圈並正常解構，移除 /dev/shm 中的共享記憶體
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#include "../src/ipc/shm_frame_producer.h"
+
+static std::atomic<bool> g_stop_requested(false);
+
+static void onStopSignal(int) {
+    g_stop_requested.store(true);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <camera_index|path_to_video> [/shm_name] [slot_count]" << std::endl;
+        return -1;
+    }
+    std::string source = argv[1];
+    std::string shm_name = (argc > 2) ? argv[2] : "/yolo_frames";
+    uint32_t slot_count = 4;
+    if (argc > 3) {
+        try {
+            unsigned long parsed = std::stoul(argv[3]);
+            if (parsed < 2 || parsed > 1024) {
+                throw std::out_of_range("slot_count");
+            }
+            slot_count = static_cast<uint32_t>(parsed);
+        } catch (const std::exception&) {
+            std::cerr << "Error: slot_count must be an integer between 2 and 1024: " << argv[3] << std::endl;
+            return -1;
+        }
+    }
+
+    // 短的純數字視為攝影機編號，其餘 (含過長的數字) 當作路徑
+    bool is_camera = !source.empty() && source.size() <= 4 &&
+                     source.find_first_not_of("0123456789") == std::string::npos;
+    cv::VideoCapture capture;
+    bool opened = is_camera ? capture.open(std::stoi(source)) : capture.open(source);
+    if (!opened || !capture.isOpened()) {
+        std::cerr << "Error: Could not open video source: " << source << std::endl;
+        return -1;
+    }
+
+    // 先讀一幀以確定影格尺寸
+    cv::Mat first_frame;
+    if (!capture.read(first_frame) || first_frame.empty()) {
+        std::cerr << "Error: Could not read first frame from: " << source << std::endl;
+        return -1;
+    }
+
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+
+    std::unique_ptr<ShmFrameProducer> producer;
+    try {
+        producer.reset(new ShmFrameProducer(shm_name, first_frame.cols, first_frame.rows, slot_count));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+    producer->publish(first_frame.data, first_frame.step);
+    std::cout << "Publishing " << first_frame.cols << "x" << first_frame.rows
+              << " BGR frames to " << shm_name << " (" << slot_count << " slots)" << std::endl;
+
+    // 影片檔按原始幀率發布以模擬即時來源
+    double source_fps = capture.get(cv::CAP_PROP_FPS);
+    bool pace_to_fps = !is_camera && source_fps > 0.0;
+    auto next_frame_time = std::chrono::steady_clock::now();
+
+    while (!g_stop_requested.load() && capture.grab()) {
+        // 讓解碼結果直接寫進共享記憶體 slot，不經過中間緩衝區或編碼
+        uint8_t* slot_pixels = producer->beginFrame();
+        cv::Mat slot_image(first_frame.rows, first_frame.cols, CV_8UC3, slot_pixels, producer->stride());
+        if (!capture.retrieve(slot_image) || slot_image.data != slot_pixels) {
+            // 解碼失敗或影格尺寸改變 (retrieve 重新配置了緩衝區)，共享布局已不適用
+            producer->abortFrame();
+            std::cerr << "Error: frame decode failed or frame size changed, stopping." << std::endl;
+            return -1;
+        }
+        producer->commitFrame();
+        if (pace_to_fps) {
+            next_frame_time += std::chrono::microseconds(static_cast<int64_t>(1e6 / source_fps));
+            std::this_thread::sleep_until(next_frame_time);
+        }
+    }
+    if (g_stop_requested.load()) {
+        std::cout << "Stop requested, removing " << shm_name << std::endl;
+    }
+    return 0; // producer 釋放時解除映射並移除共享記憶體名稱
+}